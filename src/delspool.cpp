@@ -0,0 +1,177 @@
+/*
+ *  workspace++
+ *
+ *  spool of deletion tickets of ws_release --delete-data
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <yaml-cpp/yaml.h>
+
+#include "delspool.h"
+#include "trustedfile.h"
+
+using namespace std;
+
+
+/*
+ * write content to dir/name through a temporary file, so readers never see half a file
+ */
+static bool writefile(const string &dir, const string &name, const string &content)
+{
+    string tmp = dir + "/." + name + ".tmp";
+    {
+        ofstream out(tmp.c_str());
+        if (!(out << content)) {
+            unlink(tmp.c_str());
+            return false;
+        }
+    }
+    if (chmod(tmp.c_str(), 0644) != 0 || rename(tmp.c_str(), (dir + "/" + name).c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+DelSpool::DelSpool(const string database) : dir(database + "/" + DELSPOOL_NAME)
+{
+}
+
+bool DelSpool::enqueue(const DelTicket &ticket, const uid_t uid, const gid_t gid)
+{
+    bool made = false;
+    if (mkdir(dir.c_str(), 0755) == 0) {
+        made = true;
+    } else if (errno != EEXIST) {
+        return false;
+    }
+    // everything from here on is relative to the spool, and only to a spool of the DB user,
+    // a symlink or a directory of someone else is refused
+    int dirfd = open(dir.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+    if (dirfd < 0) return false;
+    struct stat st;
+    if (fstat(dirfd, &st) != 0 || st.st_uid != uid) {
+        close(dirfd);
+        if (made) rmdir(dir.c_str());
+        return false;
+    }
+    // the umask could have removed bits
+    if (made) fchmod(dirfd, 0755);
+
+    YAML::Emitter out;
+    out << YAML::BeginMap;
+    out << YAML::Key << "workspace" << YAML::Value << ticket.workspace;
+    out << YAML::Key << "user" << YAML::Value << ticket.user;
+    out << YAML::Key << "queued" << YAML::Value << ticket.queued;
+    out << YAML::EndMap;
+    string content = string(out.c_str()) + "\n";
+
+    // ws_expirer only trusts tickets of the DB user, the ticket belongs to it before it gets a
+    // name, so the user can not open it for writing in between (trustedfile.h)
+    bool ok = writetrusted(dirfd, ticket.id, content, uid, gid);
+    close(dirfd);
+    return ok;
+}
+
+bool DelSpool::hasticket(const string id)
+{
+    struct stat st;
+    return lstat((dir + "/" + id).c_str(), &st) == 0;
+}
+
+vector<DelTicket> DelSpool::list()
+{
+    vector<DelTicket> tickets;
+    DIR *d = opendir(dir.c_str());
+    if (!d) return tickets;
+    const size_t suffix = strlen(DELSPOOL_PROGRESS);
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        string name = e->d_name;
+        if (name[0] == '.') continue;
+        if (name.size() > suffix && name.compare(name.size() - suffix, suffix, DELSPOOL_PROGRESS) == 0) continue;
+        try {
+            YAML::Node node = YAML::LoadFile(dir + "/" + name);
+            DelTicket t;
+            t.id = name;
+            t.workspace = node["workspace"].as<string>();
+            t.user = node["user"] ? node["user"].as<string>() : "";
+            t.queued = node["queued"] ? node["queued"].as<long>() : 0;
+            tickets.push_back(t);
+        } catch (...) {
+            // broken or gone in the meantime
+        }
+    }
+    closedir(d);
+    sort(tickets.begin(), tickets.end(), [](const DelTicket &a, const DelTicket &b) { return a.id < b.id; });
+    return tickets;
+}
+
+DelProgress DelSpool::getprogress(const string id)
+{
+    DelProgress p;
+    p.state = "queued";
+    p.updated = 0;
+    p.files = p.dirs = p.errors = 0;
+    p.bytes = 0;
+    try {
+        YAML::Node node = YAML::LoadFile(dir + "/" + id + DELSPOOL_PROGRESS);
+        p.state = node["state"].as<string>();
+        p.updated = node["updated"].as<long>();
+        p.files = node["files"].as<long>();
+        p.dirs = node["dirs"].as<long>();
+        p.bytes = node["bytes"].as<unsigned long long>();
+        p.errors = node["errors"].as<long>();
+    } catch (...) {
+        // no progress yet
+    }
+    return p;
+}
+
+bool DelSpool::writeprogress(const string filename, const DelProgress &progress)
+{
+    size_t slash = filename.rfind('/');
+    if (slash == string::npos) return false;
+    YAML::Emitter out;
+    out << YAML::BeginMap;
+    out << YAML::Key << "state" << YAML::Value << progress.state;
+    out << YAML::Key << "updated" << YAML::Value << progress.updated;
+    out << YAML::Key << "files" << YAML::Value << progress.files;
+    out << YAML::Key << "dirs" << YAML::Value << progress.dirs;
+    out << YAML::Key << "bytes" << YAML::Value << progress.bytes;
+    out << YAML::Key << "errors" << YAML::Value << progress.errors;
+    out << YAML::EndMap;
+    return writefile(filename.substr(0, slash), filename.substr(slash + 1), string(out.c_str()) + "\n");
+}
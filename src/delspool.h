@@ -0,0 +1,97 @@
+#ifndef DELSPOOL_H
+#define DELSPOOL_H
+
+/*
+ *  workspace++
+ *
+ *  spool of deletion tickets of ws_release --delete-data
+ *
+ *  release moves the workspace into the deleted directory of its space as always, and then
+ *  only leaves a ticket in the spool of the DB, so it returns at once instead of deleting the
+ *  data in the foreground. ws_expirer deletes the trees of the tickets with ws_deltree, which
+ *  writes its progress next to the ticket, and removes ticket and DB entry in DB/deleted when
+ *  the tree is gone. ws_restore refuses to restore a workspace with a ticket.
+ *
+ *  spool: DB/.ws_delete_spool, owned by the DB user, one ticket per released workspace,
+ *  named like the workspace in the deleted directory (user-name-timestamp), its progress
+ *  in <ticket>.progress. Both are YAML maps:
+ *    ticket:    workspace (tree to delete), user, queued (time)
+ *    progress:  state (deleting, stopped, failed), updated (time), files, dirs, bytes, errors
+ *
+ *  ws_expirer trusts a ticket only if it belongs to the DB user or root and its workspace is
+ *  <space>/<deleted>/<ticket> for a space of the filesystem.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+using namespace std;
+
+const char DELSPOOL_NAME[] = ".ws_delete_spool";
+const char DELSPOOL_PROGRESS[] = ".progress";
+
+struct DelTicket {
+    string id;              // name of ticket, user-name-timestamp
+    string workspace;       // tree to delete, in the deleted directory of its space
+    string user;
+    long queued;
+};
+
+struct DelProgress {
+    string state;           // queued as long as there is no progress file
+    long updated;
+    long files, dirs, errors;
+    unsigned long long bytes;
+};
+
+
+class DelSpool {
+
+private:
+    string dir;
+
+public:
+    // spool of the DB directory database
+    DelSpool(const string database);
+
+    const string &getdir() {
+        return dir;
+    }
+
+    // write ticket owned by uid:gid, creating the spool if needed, false if that failed or
+    // the spool is not owned by uid. Needs the rights of the DB user, or with capabilities
+    // CAP_DAC_OVERRIDE and CAP_CHOWN, the spool has to exist then (ws_prepare, ws_expirer)
+    bool enqueue(const DelTicket &ticket, const uid_t uid, const gid_t gid);
+
+    bool hasticket(const string id);
+
+    // all tickets, sorted by name
+    vector<DelTicket> list();
+
+    // progress of ticket id, state queued if none yet
+    DelProgress getprogress(const string id);
+
+    // write progress to filename, replacing it atomically
+    static bool writeprogress(const string filename, const DelProgress &progress);
+};
+
+#endif
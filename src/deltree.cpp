@@ -0,0 +1,737 @@
+/*
+ *  workspace++
+ *
+ *  parallel deletion of directory trees
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <deque>
+#include <random>
+#include <algorithm>
+
+#include <math.h>
+
+#include <stdio.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <dirent.h>
+
+#include "deltree.h"
+
+using namespace std;
+
+// glibc only has a wrapper for getdents64 since 2.30
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+static const int DIRBUFSIZE = 64*1024;
+
+
+static const double MINRATE = 10;
+static const int BUCKETS = 128;     // latency histogram, 4 buckets per power of 2 from 1us
+
+static int bucket(double seconds)
+{
+    int b = seconds > 1e-6 ? (int)(4 * log2(seconds * 1e6)) : 0;
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+
+OpThrottle::OpThrottle(double _rate)
+    : rate(_rate), maxrate(_rate), step(0), target(0), maxinflight(0), inflight(0), active(0),
+      nextslot(std::chrono::steady_clock::now()), histogram(BUCKETS, 0), ops(0)
+{
+}
+
+void OpThrottle::settarget(double latency, int _maxinflight)
+{
+    std::lock_guard<std::mutex> lock(m);
+    target = latency;
+    if (target <= 0) return;
+    // start at the configured limit, or somewhere careful if there is none
+    rate = maxrate > 0 ? maxrate : 1000;
+    step = max(MINRATE, rate / 20);
+    maxinflight = inflight = _maxinflight < 1 ? 1 : _maxinflight;
+    windowstart = std::chrono::steady_clock::now();
+}
+
+/*
+ * each caller reserves the next free slot and sleeps until it is reached
+ */
+OpThrottle::Ticket OpThrottle::acquire()
+{
+    if (rate <= 0 && target <= 0) return Ticket();
+    std::chrono::steady_clock::time_point slot;
+    {
+        std::unique_lock<std::mutex> lock(m);
+        if (target > 0) {
+            cv.wait(lock, [this] { return active < inflight; });
+            active++;
+        }
+        auto now = std::chrono::steady_clock::now();
+        // do not save up slots while idle, allow a burst of one second at most
+        if (nextslot + std::chrono::seconds(1) < now) {
+            nextslot = now - std::chrono::seconds(1);
+        }
+        slot = nextslot;
+        nextslot += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0/rate));
+    }
+    std::this_thread::sleep_until(slot);
+    return std::chrono::steady_clock::now();
+}
+
+void OpThrottle::done(Ticket ticket)
+{
+    if (target <= 0) return;
+    auto now = std::chrono::steady_clock::now();
+    double latency = std::chrono::duration<double>(now - ticket).count();
+    {
+        std::lock_guard<std::mutex> lock(m);
+        active--;
+        ops++;
+        histogram[bucket(latency)]++;
+        window.push_back(latency);
+        if (now - windowstart >= std::chrono::milliseconds(500) && window.size() >= 10) {
+            adapt(now);
+        }
+    }
+    cv.notify_all();
+}
+
+/*
+ * one step of the controller, called with lock held
+ */
+void OpThrottle::adapt(std::chrono::steady_clock::time_point now)
+{
+    double interval = std::chrono::duration<double>(now - windowstart).count();
+    double achieved = window.size() / interval;
+    size_t n = window.size() * 9 / 10;
+    nth_element(window.begin(), window.begin() + n, window.end());
+    if (window[n] > target) {
+        rate = max(MINRATE, rate / 2);
+        inflight = max(1, inflight / 2);
+    } else {
+        // do not run away while the limit is not what holds us back
+        rate = min(rate + step, max(2 * achieved, MINRATE));
+        if (maxrate > 0) rate = min(rate, maxrate);
+        inflight = min(maxinflight, inflight + 1);
+    }
+    window.clear();
+    windowstart = now;
+}
+
+ThrottleStats OpThrottle::getstats()
+{
+    std::lock_guard<std::mutex> lock(m);
+    ThrottleStats s;
+    s.ops = ops;
+    s.rate = rate;
+    s.inflight = target > 0 ? inflight : 0;
+    s.p50 = s.p90 = s.p99 = 0;
+    double *p[] = { &s.p50, &s.p90, &s.p99 };
+    double q[] = { 0.5, 0.9, 0.99 };
+    long sum = 0;
+    int k = 0;
+    for (int b = 0; b < BUCKETS && k < 3 && ops > 0; b++) {
+        sum += histogram[b];
+        // upper bound of the bucket
+        while (k < 3 && sum >= q[k] * ops) {
+            *p[k++] = 1e-6 * pow(2.0, (b + 1) / 4.0);
+        }
+    }
+    return s;
+}
+
+
+DelTree::DelTree(int threads, double rate)
+    : nthreads(threads), throttle(rate), keeptop(false), timelimit(0), stopflag(NULL), runs(0), finished(true),
+      files(0), dirs(0), errors(0), bytes(0), firsterror(0), firstunexpected(0), resumed(false), seconds(0), pool(NULL)
+{
+    previous.files = previous.dirs = previous.errors = 0;
+    previous.bytes = 0;
+    previous.seconds = 0;
+}
+
+void DelTree::setlimit(double seconds, const std::atomic<bool> *flag)
+{
+    timelimit = seconds;
+    stopflag = flag;
+}
+
+void DelTree::setjournal(const string filename)
+{
+    journal = filename;
+}
+
+bool DelTree::expired()
+{
+    if (stopflag && *stopflag) return true;
+    return timelimit > 0 && std::chrono::steady_clock::now() >= deadline;
+}
+
+void DelTree::error(int err)
+{
+    int expected = 0;
+    errors++;
+    firsterror.compare_exchange_strong(expected, err);
+    if (err != EACCES) {
+        expected = 0;
+        firstunexpected.compare_exchange_strong(expected, err);
+    }
+}
+
+/*
+ * delete path and everything below
+ */
+bool DelTree::remove(const string path, bool _keeptop)
+{
+    keeptop = _keeptop;
+    files = dirs = errors = 0;
+    bytes = 0;
+    firsterror = 0;
+    firstunexpected = 0;
+
+    // every directory in work holds a descriptor, allow as many as we can get
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl)==0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    resumed = false;
+    auto start = std::chrono::steady_clock::now();
+    deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timelimit));
+
+    DirNode *root = new DirNode;
+    root->parent = NULL;
+    root->name = path;
+    root->fd = -1;
+    root->refs = 1;
+    root->resumed = false;
+
+    WorkPool<DirNode*> workpool(nthreads, [this](DirNode *node, int worker) { process(node, worker); });
+    pool = &workpool;
+    if (!resume(path, root)) {
+        workpool.push(root);
+    }
+    // previous is set now
+    resumed = true;
+    workpool.run();
+
+    // directories not walked yet, with paths relative to the tree
+    vector<DirNode*> left = workpool.leftover();
+    finished = left.empty();
+    vector<string> pending;
+    for (auto node : left) {
+        string rel;
+        for (DirNode *n = node; n->parent; n = n->parent) {
+            rel = rel.empty() ? n->name : n->name + "/" + rel;
+        }
+        pending.push_back(rel);
+    }
+    for (auto node : left) {
+        abandon(node);
+    }
+    pool = NULL;
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (journal != "") {
+        if (finished) {
+            unlink(journal.c_str());
+        } else {
+            writejournal(path, pending);
+        }
+    }
+
+    return errors == 0 && finished;
+}
+
+/*
+ * rebuild the pending directories of the journal below root, with all directories in
+ * between as already walked, false if there is nothing to continue from
+ */
+bool DelTree::resume(const string path, DirNode *root)
+{
+    runs = 0;
+    previous.files = previous.dirs = previous.errors = 0;
+    previous.bytes = 0;
+
+    vector<string> pending;
+    if (journal == "" || !readjournal(path, pending) || pending.empty()) return false;
+
+    root->fd = open(path.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+    if (root->fd < 0) {
+        return false;
+    }
+    root->resumed = true;
+    root->refs = 0;
+
+    map<string, DirNode*> walked;
+    for (auto const &p : pending) {
+        DirNode *parent = root;
+        string rel;
+        size_t pos = 0, slash;
+        while ((slash = p.find('/', pos)) != string::npos && parent) {
+            string name = p.substr(pos, slash - pos);
+            rel += "/" + name;
+            pos = slash + 1;
+            auto it = walked.find(rel);
+            if (it != walked.end()) {
+                parent = it->second;
+                continue;
+            }
+            int fd = openat(parent->fd, name.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            if (fd < 0) {
+                // removed meanwhile, nothing to do below
+                parent = NULL;
+                break;
+            }
+            DirNode *node = new DirNode;
+            node->parent = parent;
+            node->name = name;
+            node->fd = fd;
+            node->refs = 0;
+            node->resumed = true;
+            parent->refs++;
+            walked[rel] = node;
+            parent = node;
+        }
+        if (!parent) continue;
+        DirNode *node = new DirNode;
+        node->parent = parent;
+        node->name = p.substr(pos);
+        node->fd = -1;
+        node->refs = 1;
+        node->resumed = false;
+        parent->refs++;
+        pool->push(node);
+    }
+
+    if (root->refs == 0) {
+        // all pending directories vanished, walk what is left
+        close(root->fd);
+        root->fd = -1;
+        root->refs = 1;
+        root->resumed = false;
+        return false;
+    }
+    return true;
+}
+
+static string escape(const string &s)
+{
+    string r;
+    for (char c : s) {
+        if (c == '\\') r += "\\\\";
+        else if (c == '\n') r += "\\n";
+        else r += c;
+    }
+    return r;
+}
+
+static string unescape(const string &s)
+{
+    string r;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\\' && i + 1 < s.size()) {
+            i++;
+            r += s[i] == 'n' ? '\n' : s[i];
+        } else {
+            r += s[i];
+        }
+    }
+    return r;
+}
+
+/*
+ * drop directories below other pending directories, they are found again when those are walked
+ */
+static void toponly(vector<string> &pending)
+{
+    set<string> all(pending.begin(), pending.end());
+    vector<string> top;
+    for (auto const &p : all) {
+        bool below = false;
+        for (size_t slash = p.find('/'); slash != string::npos && !below; slash = p.find('/', slash + 1)) {
+            below = all.count(p.substr(0, slash)) > 0;
+        }
+        if (!below) top.push_back(p);
+    }
+    pending.swap(top);
+}
+
+/*
+ * read journal of tree path, false if missing, broken, for another tree or not trusted
+ */
+bool DelTree::readjournal(const string path, vector<string> &pending)
+{
+    int fd = open(journal.c_str(), O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (st.st_uid != 0 && st.st_uid != geteuid()) ||
+        (st.st_mode & (S_IWGRP|S_IWOTH))) {
+        close(fd);
+        return false;
+    }
+    string content(st.st_size, '\0');
+    bool ok = read(fd, &content[0], st.st_size) == st.st_size;
+    close(fd);
+    if (!ok) return false;
+
+    istringstream in(content);
+    string line;
+    if (!getline(in, line) || line != "wsdeljournal 1") return false;
+    if (!getline(in, line) || unescape(line) != path) return false;
+    if (!getline(in, line)) return false;
+    istringstream counts(line);
+    long oldruns;
+    DelStats old = previous;
+    if (!(counts >> oldruns >> old.files >> old.dirs >> old.bytes >> old.errors)) return false;
+
+    pending.clear();
+    while (getline(in, line)) {
+        string p = unescape(line);
+        // only plain names, nothing may lead out of the tree
+        stringstream components(p);
+        string name;
+        while (getline(components, name, '/')) {
+            if (name == "" || name == "." || name == "..") return false;
+        }
+        if (p.empty() || p[p.size()-1] == '/') return false;
+        pending.push_back(p);
+    }
+    toponly(pending);
+    runs = oldruns;
+    previous = old;
+    return true;
+}
+
+/*
+ * write journal by renaming a temporary file over it, errors are ignored,
+ * without journal the next run just walks the whole tree
+ */
+void DelTree::writejournal(const string path, vector<string> &pending)
+{
+    // the tree itself was not walked, nothing to continue from
+    if (pending.empty() || find(pending.begin(), pending.end(), "") != pending.end()) {
+        unlink(journal.c_str());
+        return;
+    }
+
+    ostringstream out;
+    out << "wsdeljournal 1\n" << escape(path) << "\n";
+    out << runs + 1 << " " << previous.files + files << " " << previous.dirs + dirs << " "
+        << previous.bytes + bytes << " " << previous.errors + errors << "\n";
+    toponly(pending);
+    for (auto const &p : pending) {
+        out << escape(p) << "\n";
+    }
+    string content = out.str();
+
+    string tmpname = journal + ".tmp." + to_string(getpid());
+    int fd = open(tmpname.c_str(), O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC|O_NOFOLLOW, 0600);
+    if (fd < 0) return;
+    bool ok = write(fd, content.data(), content.size()) == (ssize_t)content.size();
+    if (close(fd) != 0) ok = false;
+    if (!ok || rename(tmpname.c_str(), journal.c_str()) != 0) {
+        unlink(tmpname.c_str());
+    }
+}
+
+/*
+ * read one directory, unlink all non-directories and queue the subdirectories
+ */
+void DelTree::process(DirNode *node, int worker)
+{
+    if (expired()) {
+        // keep it for the journal
+        pool->stop();
+        pool->push(node, worker);
+        return;
+    }
+
+    int parentfd = node->parent ? node->parent->fd : AT_FDCWD;
+
+    node->fd = openat(parentfd, node->name.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+    if (node->fd < 0) {
+        // not a directory anymore, or a symlink to a directory, remove what is there
+        if (errno == ENOTDIR || errno == ELOOP) {
+            auto ticket = throttle.acquire();
+            int err = unlinkat(parentfd, node->name.c_str(), 0) == 0 ? 0 : errno;
+            throttle.done(ticket);
+            if (err == 0) {
+                files++;
+            } else {
+                error(err);
+            }
+        } else if (errno != ENOENT) {
+            error(errno);
+        }
+        // nothing left to remove for this node
+        if (node->parent) release(node->parent);
+        delete node;
+        return;
+    }
+
+    char buf[DIRBUFSIZE];
+    long nread;
+    bool stopped = false;
+    while (!stopped && (nread = syscall(SYS_getdents64, node->fd, buf, DIRBUFSIZE)) > 0) {
+        for (long pos = 0; pos < nread && !stopped; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (buf + pos);
+            pos += d->d_reclen;
+            if (d->d_name[0]=='.' && (d->d_name[1]==0 || (d->d_name[1]=='.' && d->d_name[2]==0))) {
+                continue;
+            }
+            unsigned char type = d->d_type;
+            struct stat st;
+            bool havestat = false;
+            if (type == DT_UNKNOWN || type == DT_REG) {
+                // some filesystems do not return a type, and we need size of files anyhow,
+                // the stat goes to the metadata server as well
+                auto ticket = throttle.acquire();
+                havestat = fstatat(node->fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+                throttle.done(ticket);
+                if (havestat) {
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+                }
+            }
+            if (type == DT_DIR) {
+                DirNode *child = new DirNode;
+                child->parent = node;
+                child->name = d->d_name;
+                child->fd = -1;
+                child->refs = 1;
+                child->resumed = false;
+                node->refs++;
+                pool->push(child, worker);
+            } else {
+                auto ticket = throttle.acquire();
+                int err = unlinkat(node->fd, d->d_name, 0) == 0 ? 0 : errno;
+                throttle.done(ticket);
+                if (err == 0) {
+                    files++;
+                    if (havestat && S_ISREG(st.st_mode)) bytes += st.st_size;
+                } else if (err != ENOENT) {
+                    error(err);
+                }
+                // a throttled directory with many files can take long
+                stopped = expired();
+            }
+        }
+        stopped = stopped || expired();
+    }
+    if (stopped) {
+        // not done with this directory, it goes to the journal and is walked again next time,
+        // subdirectories already queued are found again then
+        pool->stop();
+        pool->push(node, worker);
+        return;
+    }
+    if (nread < 0) {
+        error(errno);
+    }
+
+    release(node);
+}
+
+/*
+ * drop a reference, last one removes the directory and drops the reference to its parent
+ */
+void DelTree::release(DirNode *node)
+{
+    while (node && --node->refs == 0) {
+        DirNode *parent = node->parent;
+        close(node->fd);
+        node->fd = -1;
+        if (parent || !keeptop) {
+            auto ticket = throttle.acquire();
+            int err = unlinkat(parent ? parent->fd : AT_FDCWD, node->name.c_str(), AT_REMOVEDIR) == 0 ? 0 : errno;
+            throttle.done(ticket);
+            if (err == 0) {
+                dirs++;
+            } else if (err == ENOTEMPTY && node->resumed) {
+                // something was left behind in an earlier run, walk it again
+                node->resumed = false;
+                node->refs = 1;
+                pool->push(node);
+                return;
+            } else if (err != ENOENT) {
+                error(err);
+            }
+        }
+        delete node;
+        node = parent;
+    }
+}
+
+/*
+ * drop a reference of a directory left for the next run, nothing is removed
+ */
+void DelTree::abandon(DirNode *node)
+{
+    while (node && --node->refs == 0) {
+        DirNode *parent = node->parent;
+        if (node->fd >= 0) close(node->fd);
+        delete node;
+        node = parent;
+    }
+}
+
+DelStats DelTree::getprogress()
+{
+    DelStats s;
+    s.files = files;
+    s.dirs = dirs;
+    s.bytes = bytes;
+    s.errors = errors;
+    s.seconds = 0;
+    if (resumed) {
+        s.files += previous.files;
+        s.dirs += previous.dirs;
+        s.bytes += previous.bytes;
+        s.errors += previous.errors;
+    }
+    s.throttle = ThrottleStats();
+    return s;
+}
+
+DelStats DelTree::getstats()
+{
+    DelStats s;
+    s.files = files;
+    s.dirs = dirs;
+    s.bytes = bytes;
+    s.errors = errors;
+    s.seconds = seconds;
+    s.throttle = throttle.getstats();
+    return s;
+}
+
+
+/*
+ * count the entries of directory path and the bytes of its files, subdirectories are returned,
+ * false if it can not be read
+ */
+static bool countdir(const string &path, long &files, unsigned long long &bytes, vector<string> &subdirs,
+                     OpThrottle &throttle)
+{
+    int fd = open(path.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+    if (fd < 0) return false;
+    char buf[DIRBUFSIZE];
+    long nread;
+    while ((nread = syscall(SYS_getdents64, fd, buf, DIRBUFSIZE)) > 0) {
+        for (long pos = 0; pos < nread; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (buf + pos);
+            pos += d->d_reclen;
+            if (d->d_name[0]=='.' && (d->d_name[1]==0 || (d->d_name[1]=='.' && d->d_name[2]==0))) {
+                continue;
+            }
+            unsigned char type = d->d_type;
+            struct stat st;
+            if (type == DT_UNKNOWN || type == DT_REG) {
+                auto ticket = throttle.acquire();
+                bool havestat = fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+                throttle.done(ticket);
+                if (havestat) {
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+                    if (S_ISREG(st.st_mode)) bytes += st.st_size;
+                }
+            }
+            if (type == DT_DIR) {
+                subdirs.push_back(path + "/" + d->d_name);
+            } else {
+                files++;
+            }
+        }
+    }
+    close(fd);
+    return true;
+}
+
+bool estimatetree(const string path, long maxdirs, TreeEstimate &estimate, double rate)
+{
+    OpThrottle throttle(rate);
+    const int PROBES = 32;
+    const int MAXDEPTH = 256;
+
+    estimate.files = 0;
+    estimate.dirs = 0;
+    estimate.bytes = 0;
+    estimate.exact = true;
+
+    deque<string> queue;
+    vector<string> subdirs;
+    if (!countdir(path, estimate.files, estimate.bytes, subdirs, throttle)) return false;
+    estimate.dirs = 1;
+    queue.insert(queue.end(), subdirs.begin(), subdirs.end());
+    while (!queue.empty() && estimate.dirs < maxdirs) {
+        subdirs.clear();
+        // gone or not readable, counts as empty
+        countdir(queue.front(), estimate.files, estimate.bytes, subdirs, throttle);
+        estimate.dirs++;
+        queue.pop_front();
+        queue.insert(queue.end(), subdirs.begin(), subdirs.end());
+    }
+    if (queue.empty()) return true;
+
+    // fixed seed, so the plan for the same tree is the same
+    std::mt19937 rng(queue.size());
+    double files = 0, dirs = 0, bytes = 0;
+    for (int i = 0; i < PROBES; i++) {
+        string dir = queue[rng() % queue.size()];
+        double weight = 1;
+        for (int depth = 0; depth < MAXDEPTH; depth++) {
+            long n = 0;
+            unsigned long long b = 0;
+            subdirs.clear();
+            if (!countdir(dir, n, b, subdirs, throttle)) break;
+            files += weight * n;
+            bytes += weight * b;
+            dirs += weight;
+            if (subdirs.empty()) break;
+            weight *= subdirs.size();
+            dir = subdirs[rng() % subdirs.size()];
+        }
+    }
+    estimate.files += llround(files / PROBES * queue.size());
+    estimate.dirs += llround(dirs / PROBES * queue.size());
+    estimate.bytes += llround(bytes / PROBES * queue.size());
+    estimate.exact = false;
+    return true;
+}
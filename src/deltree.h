@@ -0,0 +1,228 @@
+#ifndef DELTREE_H
+#define DELTREE_H
+
+/*
+ *  workspace++
+ *
+ *  parallel deletion of directory trees
+ *
+ *  the tree is walked with getdents64 and all operations are done with unlinkat relative
+ *  to open directory file descriptors, so no path has to be resolved twice and symlinks
+ *  are never followed. Work is spread over a pool of work stealing threads, the rate of
+ *  metadata operations can be capped to protect the metadata servers.
+ *
+ *  a run can be limited in time. When it is stopped, the directories not yet walked are
+ *  the only ones which can still contain files, everything else is gone or holds only
+ *  directories which are in that list or below. These pending directories are written to
+ *  a journal together with the counts of all runs, and the next run on the same tree
+ *  starts from them instead of walking the whole tree again from the top.
+ *
+ *  journal format (text), paths relative to the tree, \ and newline escaped:
+ *    wsdeljournal 1
+ *    <tree>
+ *    <runs> <files> <dirs> <bytes> <errors>
+ *    <pending directory>
+ *    ...
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "workpool.h"
+
+using namespace std;
+
+
+/*
+ * caps the number of metadata operations per second over all threads,
+ * a rate of 0 means no limit
+ *
+ * with a target latency, the latency of the operations is measured and rate and number of
+ * operations in flight are adapted AIMD like every half second: halved if the 90th percentile
+ * of the last interval is above the target, increased by a constant step otherwise. The rate
+ * given to the constructor is the upper limit then.
+ */
+struct ThrottleStats {
+    long ops;               // operations measured
+    double rate;            // rate limit reached, 0 if unlimited
+    int inflight;           // limit of operations in flight reached, 0 if unlimited
+    double p50, p90, p99;   // latency percentiles in seconds, 0 if not measured
+};
+
+class OpThrottle {
+
+public:
+    typedef std::chrono::steady_clock::time_point Ticket;
+
+private:
+    double rate, maxrate, step;
+    double target;
+    int maxinflight, inflight, active;
+    std::mutex m;
+    std::condition_variable cv;
+    std::chrono::steady_clock::time_point nextslot, windowstart;
+    vector<double> window;
+    vector<long> histogram;
+    long ops;
+
+    void adapt(std::chrono::steady_clock::time_point now);
+
+public:
+    OpThrottle(double _rate);
+
+    // adapt towards target latency of a single operation in seconds, 0 disables
+    void settarget(double latency, int maxinflight);
+
+    // blocks until the caller may issue the next operation
+    Ticket acquire();
+
+    // the operation of ticket is done
+    void done(Ticket ticket);
+
+    ThrottleStats getstats();
+};
+
+
+/*
+ * counters of a deletion run
+ */
+struct DelStats {
+    long files;
+    long dirs;
+    unsigned long long bytes;
+    long errors;
+    double seconds;
+    ThrottleStats throttle;
+};
+
+
+class DelTree {
+
+private:
+    struct DirNode {
+        DirNode *parent;
+        string name;
+        int fd;
+        std::atomic<long> refs;
+        bool resumed;       // walked in an earlier run, only holds pending directories
+    };
+
+    int nthreads;
+    OpThrottle throttle;
+    bool keeptop;
+    double timelimit;
+    std::chrono::steady_clock::time_point deadline;
+    const std::atomic<bool> *stopflag;
+    string journal;
+    DelStats previous;
+    long runs;
+    bool finished;
+    std::atomic<long> files, dirs, errors;
+    std::atomic<unsigned long long> bytes;
+    std::atomic<int> firsterror, firstunexpected;
+    std::atomic<bool> resumed;
+    double seconds;
+    WorkPool<DirNode*> *pool;
+
+    void process(DirNode *node, int worker);
+    void release(DirNode *node);
+    void abandon(DirNode *node);
+    void error(int err);
+    bool expired();
+    bool resume(const string path, DirNode *root);
+    bool readjournal(const string path, vector<string> &pending);
+    void writejournal(const string path, vector<string> &pending);
+
+public:
+    // threads: number of worker threads, rate: maximum metadata operations per second, 0 is unlimited
+    DelTree(int threads, double rate);
+
+    // adapt rate and concurrency towards target latency in seconds, 0 keeps the fixed rate
+    void settarget(double latency) {
+        throttle.settarget(latency, nthreads);
+    }
+
+    // stop after seconds (0 is no limit) or as soon as *flag is set, e.g. by a signal handler
+    void setlimit(double seconds, const std::atomic<bool> *flag=NULL);
+
+    // continue from and record progress in journal file, only used by root or the owner
+    void setjournal(const string filename);
+
+    // delete path and everything below, if keeptop is set the directory itself is kept
+    // returns true if everything could be removed
+    bool remove(const string path, bool keeptop=false);
+
+    // false if the last remove() was stopped by the limit
+    bool isfinished() {
+        return finished;
+    }
+
+    // counts of the last remove()
+    DelStats getstats();
+
+    // counts of all runs so far, can be called from another thread during remove(),
+    // without time and throttle statistics
+    DelStats getprogress();
+
+    // counts and number of runs before the last remove() from the journal, 0 if none
+    DelStats getprevious() {
+        return previous;
+    }
+    long getruns() {
+        return runs;
+    }
+
+    // errno of first failed operation, 0 if none
+    int getfirsterror() {
+        return firsterror;
+    }
+
+    // errno of first failed operation other than EACCES, which is expected where the user
+    // can not write, so a later EIO or ENOSPC is not hidden behind it, 0 if none
+    int getfirstunexpected() {
+        return firstunexpected;
+    }
+};
+
+
+/*
+ * estimated size of a tree, for the plans and the deletion scheduler of ws_expirer,
+ * nothing is changed
+ *
+ * the first maxdirs directories are read breadth first. If there are more, the subtrees
+ * not read are extrapolated from random descents into a sample of them, each descent
+ * multiplying the numbers of subdirectories on its way (Knuth's estimator of tree size).
+ */
+struct TreeEstimate {
+    long files;                 // everything but directories
+    long dirs;                  // including the top
+    unsigned long long bytes;   // of regular files
+    bool exact;                 // the tree was read completely
+};
+
+// false if path can not be read, rate limits the stat calls per second like for the deletion, 0 is unlimited
+bool estimatetree(const string path, long maxdirs, TreeEstimate &estimate, double rate=0);
+
+#endif
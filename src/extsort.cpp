@@ -0,0 +1,212 @@
+/*
+ *  workspace++
+ *
+ *  external sort of strings with bounded memory
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Posix
+#include <unistd.h>
+
+#include "extsort.h"
+
+using namespace std;
+
+static const size_t READBUFSIZE = 64*1024;
+static const size_t MAXRUNS = 64;
+
+
+RunReader::RunReader(int _fd, off_t _size) : fd(_fd), offset(0), size(_size), pos(0), len(0), failed(false)
+{
+}
+
+/*
+ * make sure need bytes are buffered, false at end of run, or if it could not be read (failed)
+ */
+bool RunReader::fill(size_t need)
+{
+    if (len - pos >= need) return true;
+    // keep what is left, records can cross buffer boundaries
+    buf.erase(buf.begin(), buf.begin() + pos);
+    len -= pos;
+    pos = 0;
+    buf.resize(max(READBUFSIZE, need));
+    while (len < need && offset < size) {
+        ssize_t n = pread(fd, buf.data() + len, buf.size() - len, offset);
+        if (n <= 0) {
+            // a run is never shorter than its size, so that is an error as well
+            failed = true;
+            return false;
+        }
+        len += n;
+        offset += n;
+    }
+    if (len < need) {
+        // a record cut at the end of the run
+        if (len > 0) failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool RunReader::next(string &s)
+{
+    uint32_t l;
+    if (!fill(sizeof(l))) return false;
+    memcpy(&l, buf.data() + pos, sizeof(l));
+    pos += sizeof(l);
+    if (!fill(l)) {
+        failed = true;
+        return false;
+    }
+    s.assign(buf.data() + pos, l);
+    pos += l;
+    return true;
+}
+
+
+SortedStream::SortedStream(const vector<pair<int, off_t> > &runs) : failed(false)
+{
+    for (auto const &r : runs) {
+        readers.push_back(unique_ptr<RunReader>(new RunReader(r.first, r.second)));
+        string s;
+        if (readers.back()->next(s)) {
+            heads.push(Head(s, readers.size() - 1));
+        } else if (!readers.back()->ok()) {
+            failed = true;
+        }
+    }
+}
+
+bool SortedStream::next(string &s)
+{
+    // a merge without one of its runs is not sorted output of all, stop
+    if (failed || heads.empty()) return false;
+    Head h = heads.top();
+    heads.pop();
+    s.swap(h.first);
+    string n;
+    if (readers[h.second]->next(n)) {
+        heads.push(Head(n, h.second));
+    } else if (!readers[h.second]->ok()) {
+        failed = true;
+    }
+    return true;
+}
+
+
+ExternalSorter::ExternalSorter(size_t _memlimit, const string _tmpdir)
+    : memlimit(_memlimit), used(0), tmpdir(_tmpdir), failed(false)
+{
+}
+
+ExternalSorter::~ExternalSorter()
+{
+    for (auto const &r : runs) {
+        close(r.first);
+    }
+}
+
+/*
+ * write buffer, or everything from stream, as new run to an unlinked temporary file
+ */
+void ExternalSorter::writerun(SortedStream *stream)
+{
+    string name = tmpdir + "/ws_sort.XXXXXX";
+    vector<char> tmpl(name.begin(), name.end());
+    tmpl.push_back(0);
+    int fd = mkstemp(tmpl.data());
+    if (fd < 0) {
+        failed = true;
+        return;
+    }
+    unlink(tmpl.data());
+
+    string out;
+    off_t size = 0;
+    auto put = [&](const string &s) {
+        uint32_t l = s.size();
+        out.append((const char *)&l, sizeof(l));
+        out.append(s);
+        if (out.size() >= READBUFSIZE) {
+            if (write(fd, out.data(), out.size()) != (ssize_t)out.size()) failed = true;
+            size += out.size();
+            out.clear();
+        }
+    };
+    if (stream) {
+        string s;
+        while (stream->next(s)) put(s);
+        if (!stream->ok()) failed = true;
+    } else {
+        for (auto const &s : buffer) put(s);
+    }
+    if (!out.empty()) {
+        if (write(fd, out.data(), out.size()) != (ssize_t)out.size()) failed = true;
+        size += out.size();
+    }
+    runs.push_back(make_pair(fd, size));
+}
+
+void ExternalSorter::add(const string &s)
+{
+    buffer.push_back(s);
+    // rough size of a string in memory
+    used += s.size() + sizeof(string) + 16;
+    if (memlimit > 0 && used >= memlimit) {
+        seal();
+    }
+}
+
+void ExternalSorter::seal()
+{
+    if (buffer.empty()) return;
+    sort(buffer.begin(), buffer.end());
+    writerun(NULL);
+    vector<string>().swap(buffer);
+    used = 0;
+
+    if (runs.size() >= MAXRUNS) {
+        // merge all runs into one
+        vector<pair<int, off_t> > old;
+        old.swap(runs);
+        {
+            SortedStream all(old);
+            writerun(&all);
+        }
+        for (auto const &r : old) {
+            close(r.first);
+        }
+    }
+}
+
+unique_ptr<SortedStream> ExternalSorter::stream()
+{
+    seal();
+    return unique_ptr<SortedStream>(new SortedStream(runs));
+}
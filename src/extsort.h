@@ -0,0 +1,121 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+/*
+ *  workspace++
+ *
+ *  external sort of strings with bounded memory
+ *
+ *  strings are collected in memory up to a limit, then sorted and written as a run to an
+ *  unlinked temporary file. Reading merges all runs as one sorted stream, several streams
+ *  can read the same sorter at the same time. If there are too many runs, they are merged
+ *  into one, so the number of open files stays bounded as well.
+ *
+ *  run format: for each string its length as uint32_t in native byte order, then the bytes
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <sys/types.h>
+
+using namespace std;
+
+
+/*
+ * sequential reader of one run
+ */
+class RunReader {
+
+private:
+    int fd;
+    off_t offset, size;
+    vector<char> buf;
+    size_t pos, len;
+    bool failed;
+
+    bool fill(size_t need);
+
+public:
+    RunReader(int fd, off_t size);
+    bool next(string &s);
+
+    // false if the run could not be read to its end
+    bool ok() {
+        return !failed;
+    }
+};
+
+
+/*
+ * sorted stream over all runs of a sorter
+ */
+class SortedStream {
+
+private:
+    typedef pair<string, size_t> Head;
+    vector<unique_ptr<RunReader> > readers;
+    priority_queue<Head, vector<Head>, greater<Head> > heads;
+
+    bool failed;
+
+public:
+    SortedStream(const vector<pair<int, off_t> > &runs);
+    bool next(string &s);
+
+    // false if a run could not be read, next ended early then
+    bool ok() {
+        return !failed;
+    }
+};
+
+
+class ExternalSorter {
+
+private:
+    size_t memlimit, used;
+    string tmpdir;
+    vector<string> buffer;
+    vector<pair<int, off_t> > runs;       // fd and size of each run
+    bool failed;
+
+    void writerun(SortedStream *stream);
+
+public:
+    // memlimit in bytes, temporary files in tmpdir
+    ExternalSorter(size_t memlimit, const string tmpdir);
+    ~ExternalSorter();
+
+    void add(const string &s);
+
+    // write what is in memory as a run, call before reading
+    void seal();
+
+    // false if a temporary file could not be written, or read back when runs were merged
+    bool ok() {
+        return !failed;
+    }
+
+    unique_ptr<SortedStream> stream();
+};
+
+#endif
@@ -0,0 +1,245 @@
+/*
+ *  workspace++
+ *
+ *  file system credentials and capabilities of a thread
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <atomic>
+#include <vector>
+
+#include <stdlib.h>
+
+// Posix
+#include <unistd.h>
+#include <sys/fsuid.h>
+
+#ifndef SETUID
+#include <sys/capability.h>
+#endif
+
+#include "fscred.h"
+
+using namespace std;
+
+// system calls changing capabilities and ids, for --debug
+static std::atomic<long> capcalls(0), idcalls(0);
+
+// capabilities raised in this thread by CapScope, one bit per capability
+static thread_local uint64_t raised = 0;
+
+#ifndef SETUID
+// permitted set after CapScope::drop, all raises go with one cap_set_proc from there
+static bool permittedknown = false;
+static uint64_t permitted = 0;
+#endif
+
+
+// setfsuid and setfsgid return the old id even if they fail, an invalid id only asks
+static uid_t changefsuid(const uid_t uid)
+{
+    idcalls++;
+    return setfsuid(uid);
+}
+
+static gid_t changefsgid(const gid_t gid)
+{
+    idcalls++;
+    return setfsgid(gid);
+}
+
+#ifndef SETUID
+/*
+ * make the effective set of this thread caps, false on failure
+ */
+static bool seteffective(const uint64_t caps)
+{
+    cap_t c;
+    if (permittedknown) {
+        c = cap_init();
+    } else {
+        capcalls++;
+        c = cap_get_proc();
+    }
+    if (!c) return false;
+    vector<cap_value_t> perm, eff;
+    for (int cap = 0; cap < 64; cap++) {
+        uint64_t bit = 1ULL << cap;
+        if (permitted & bit) perm.push_back(cap);
+        if (caps & bit) eff.push_back(cap);
+    }
+    bool ok;
+    if (permittedknown) {
+        ok = perm.empty() || cap_set_flag(c, CAP_PERMITTED, perm.size(), perm.data(), CAP_SET) == 0;
+    } else {
+        ok = cap_clear_flag(c, CAP_EFFECTIVE) == 0;
+    }
+    if (ok && !eff.empty()) ok = cap_set_flag(c, CAP_EFFECTIVE, eff.size(), eff.data(), CAP_SET) == 0;
+    if (ok) {
+        capcalls++;
+        ok = cap_set_proc(c) == 0;
+    }
+    if (!ok) {
+        cerr << "Error: problem with capabilities." << endl;
+        capcalls++;
+        cap_t cur = cap_get_proc();
+        if (cur) {
+            char *text = cap_to_text(cur, NULL);
+            cerr << "Running with capabilities: " << text << endl;
+            cap_free(text);
+            cap_free(cur);
+        }
+    }
+    cap_free(c);
+    return ok;
+}
+#endif
+
+
+bool FsCred::setuid(const uid_t uid)
+{
+    changefsuid(uid);
+    return changefsuid((uid_t)-1) == uid;
+}
+
+bool FsCred::setgid(const gid_t gid)
+{
+    changefsgid(gid);
+    return changefsgid((gid_t)-1) == gid;
+}
+
+FsCred::FsCred(const uid_t uid, const gid_t gid) : oldraised(raised)
+{
+    oldgid = changefsgid(gid);
+    bool ok = changefsgid((gid_t)-1) == gid;
+    if (ok) {
+        olduid = changefsuid(uid);
+        ok = changefsuid((uid_t)-1) == uid;
+    }
+    if (!ok) {
+        cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
+        exit(-1);
+    }
+#ifdef SETUID
+    // any fsuid but 0 takes the capabilities of the thread
+    if (uid != 0) raised = 0;
+#endif
+}
+
+FsCred::~FsCred()
+{
+    if (!setuid(olduid) || !setgid(oldgid)) {
+        cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
+        exit(-1);
+    }
+    raised = oldraised;
+}
+
+void FsCred::keepgid(const gid_t gid)
+{
+#ifdef SETUID
+    idcalls++;
+    if (setresgid(-1, -1, gid) != 0) {
+        cerr << "Error: can not setgid. Bad installation?" << endl;
+        exit(-1);
+    }
+#endif
+}
+
+
+CapScope::CapScope(std::initializer_list<int> caps, const int srcline, const char *srcfile) : added(0), olduid(0)
+{
+    for (int cap : caps) {
+        added |= 1ULL << cap;
+    }
+    // enclosing scopes have raised these already
+    added &= ~raised;
+    if (added == 0) return;
+#ifdef SETUID
+    // fsuid 0 gives all file system capabilities at once
+    if (raised == 0) {
+        olduid = changefsuid(0);
+        if (changefsuid((uid_t)-1) != 0) {
+            cerr << "Error: can not change uid. (line " << __LINE__ << ", from " << srcfile << ":" << srcline << ")" << endl;
+            exit(1);
+        }
+    }
+#else
+    if (!seteffective(raised | added)) {
+        cerr << "Error: problem raising capabilities. (from " << srcfile << ":" << srcline << ")" << endl;
+        exit(1);
+    }
+#endif
+    raised |= added;
+}
+
+CapScope::~CapScope()
+{
+    if (added == 0) return;
+    raised &= ~added;
+#ifdef SETUID
+    if (raised == 0 && !FsCred::setuid(olduid)) {
+        cerr << "Error: can not change uid. (line " << __LINE__ << ")" << endl;
+        exit(1);
+    }
+#else
+    if (!seteffective(raised)) {
+        cerr << "Error: problem lowering capabilities." << endl;
+        exit(1);
+    }
+#endif
+}
+
+bool CapScope::drop(std::initializer_list<int> caps, const uid_t uid)
+{
+#ifdef SETUID
+    idcalls++;
+    return seteuid(uid) == 0;
+#else
+    uint64_t mask = 0;
+    for (int cap : caps) {
+        mask |= 1ULL << cap;
+    }
+    vector<cap_value_t> list;
+    for (int cap : caps) {
+        list.push_back(cap);
+    }
+    cap_t c = cap_init();
+    bool ok = c && cap_set_flag(c, CAP_PERMITTED, list.size(), list.data(), CAP_SET) == 0;
+    if (ok) {
+        capcalls++;
+        ok = cap_set_proc(c) == 0;
+    }
+    if (c) cap_free(c);
+    if (ok) {
+        permitted = mask;
+        permittedknown = true;
+        raised = 0;
+    }
+    return ok;
+#endif
+}
+
+void CapScope::getstats(long &_capcalls, long &_idcalls)
+{
+    _capcalls = capcalls;
+    _idcalls = idcalls;
+}
@@ -0,0 +1,103 @@
+#ifndef FSCRED_H
+#define FSCRED_H
+
+/*
+ *  workspace++
+ *
+ *  file system credentials and capabilities of a thread
+ *
+ *  seteuid and setegid change all threads of a process (glibc passes the change on to every
+ *  thread), so a process can only act as one user at a time. setfsuid and setfsgid are plain
+ *  system calls and change the ids the calling thread uses for file access only, new threads
+ *  start with the ids of the thread creating them.
+ *
+ *  With SETUID the tools run with the DB user as effective uid and root as saved uid, and
+ *  keep the DB group as saved gid (keepgid), so each thread can act as root (CapScope), as
+ *  DB user (FsCred) or as the calling user (FsCred) without disturbing the others.
+ *  Taking fsuid 0 puts the file system capabilities (CAP_CHOWN, CAP_DAC_OVERRIDE,
+ *  CAP_DAC_READ_SEARCH, CAP_FOWNER, CAP_FSETID) into the effective set of the thread, any
+ *  other fsuid removes them again. The capability build has no CAP_SETUID, a thread can only
+ *  take the ids of the calling user there.
+ *
+ *  CapScope raises capabilities for the rest of a block and lowers them at its end, also when
+ *  the block is left early. Each thread keeps a record of the capabilities it has raised, a
+ *  nested scope only raises what is not raised yet and does no system call if nothing is
+ *  missing. With SETUID all capabilities come with one setfsuid(0), a FsCred scope for another
+ *  user inside a CapScope takes them away until it ends. Without SETUID the effective set is
+ *  built from the permitted set CapScope::drop left, and set with one cap_set_proc.
+ *  All capability and id changes are counted for --debug.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <initializer_list>
+#include <stdint.h>
+#include <sys/types.h>
+
+
+class FsCred {
+
+private:
+    uid_t olduid;
+    gid_t oldgid;
+    uint64_t oldraised;
+
+    FsCred(const FsCred &) = delete;
+    FsCred &operator=(const FsCred &) = delete;
+
+public:
+    // act as uid and gid for file access in this thread until the end of the scope,
+    // exits if that is not allowed
+    FsCred(const uid_t uid, const gid_t gid);
+    ~FsCred();
+
+    // change only the fsuid of this thread, false if not allowed
+    static bool setuid(const uid_t uid);
+    static bool setgid(const gid_t gid);
+
+    // keep gid as saved gid of the process, so threads can take it later,
+    // has to be called as root before the privileges are dropped, SETUID only
+    static void keepgid(const gid_t gid);
+};
+
+
+class CapScope {
+
+private:
+    uint64_t added;     // capabilities raised by this scope
+    uid_t olduid;       // fsuid before, SETUID only
+
+    CapScope(const CapScope &) = delete;
+    CapScope &operator=(const CapScope &) = delete;
+
+public:
+    // raise caps in this thread until the end of the scope, exits if that fails,
+    // srcline and srcfile are for the error message
+    CapScope(std::initializer_list<int> caps, const int srcline, const char *srcfile);
+    ~CapScope();
+
+    // keep only caps in the permitted set, or take uid as euid with SETUID,
+    // false if that failed
+    static bool drop(std::initializer_list<int> caps, const uid_t uid);
+
+    // system calls changing capabilities and ids so far
+    static void getstats(long &capcalls, long &idcalls);
+};
+
+#endif
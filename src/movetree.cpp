@@ -0,0 +1,439 @@
+/*
+ *  workspace++
+ *
+ *  move directory trees between filesystems
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#include <sys/xattr.h>
+#include <dirent.h>
+
+#include "movetree.h"
+#include "deltree.h"
+
+using namespace std;
+
+// glibc only has a wrapper for getdents64 since 2.30
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+static const int DIRBUFSIZE = 64*1024;
+static const size_t COPYCHUNK = 64*1024*1024;
+static const size_t BUFSIZE = 1024*1024;
+
+
+MoveTree::MoveTree(int threads, int _progress)
+    : nthreads(threads), progress(_progress), rootcreated(false), files(0), dirs(0), errors(0), bytes(0), firsterror(0), seconds(0), pool(NULL)
+{
+}
+
+void MoveTree::error(int err)
+{
+    int expected = 0;
+    errors++;
+    firsterror.compare_exchange_strong(expected, err);
+}
+
+/*
+ * copy source to target and remove source if everything was copied
+ */
+int MoveTree::move(const string source, const string _target)
+{
+    target = _target;
+    files = dirs = errors = 0;
+    bytes = 0;
+    firsterror = 0;
+    links.clear();
+    rootcreated = false;
+
+    // every directory in work holds two descriptors, allow as many as we can get
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl)==0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    // never copy into or over something existing
+    struct stat tst;
+    if (lstat(target.c_str(), &tst) == 0) {
+        return EEXIST;
+    }
+
+    Item *root = new Item;
+    if (lstat(source.c_str(), &root->st)) {
+        int err = errno;
+        delete root;
+        return err;
+    }
+    root->parent = NULL;
+    root->name = source;
+    root->srcfd = root->dstfd = -1;
+    root->refs = 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // tell the user we are still alive, copies can take long
+    std::atomic<bool> done(false);
+    std::thread monitor;
+    if (progress > 0) {
+        monitor = std::thread([this, &done]() {
+            int ticks = 0;
+            while (!done) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (++ticks % (progress*10) == 0 && !done) {
+                    cerr << "Info: copied " << files << " files and " << dirs << " directories (" << bytes << " bytes) so far" << endl;
+                }
+            }
+        });
+    }
+
+    WorkPool<Item*> workpool(nthreads, [this](Item *item, int worker) { process(item, worker); });
+    pool = &workpool;
+    workpool.push(root);
+    workpool.run();
+    pool = NULL;
+
+    done = true;
+    if (monitor.joinable()) monitor.join();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    DelTree deltree(nthreads, 0);
+    if (errors > 0) {
+        // leave the source as it is, remove the incomplete copy if we created it
+        int err = firsterror;
+        if (rootcreated) {
+            deltree.remove(target);
+        }
+        return err;
+    }
+
+    if (!deltree.remove(source)) {
+        return deltree.getfirsterror();
+    }
+    return 0;
+}
+
+void MoveTree::process(Item *item, int worker)
+{
+    if (S_ISDIR(item->st.st_mode)) {
+        copydir(item, worker);
+    } else {
+        copyother(item);
+        Item *parent = item->parent;
+        delete item;
+        release(parent);
+    }
+}
+
+/*
+ * create the target directory and queue all entries of the source directory
+ */
+void MoveTree::copydir(Item *item, int worker)
+{
+    int srcparent = item->parent ? item->parent->srcfd : AT_FDCWD;
+    int dstparent = item->parent ? item->parent->dstfd : AT_FDCWD;
+    const char *dstname = item->parent ? item->name.c_str() : target.c_str();
+
+    item->srcfd = openat(srcparent, item->name.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+    if (item->srcfd < 0) {
+        error(errno);
+        Item *parent = item->parent;
+        delete item;
+        release(parent);
+        return;
+    }
+    // owner only during the copy, final mode is set when all entries are done
+    if (mkdirat(dstparent, dstname, 0700) ||
+        (item->dstfd = openat(dstparent, dstname, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC)) < 0) {
+        error(errno);
+        close(item->srcfd);
+        Item *parent = item->parent;
+        delete item;
+        release(parent);
+        return;
+    }
+    if (!item->parent) rootcreated = true;
+
+    char buf[DIRBUFSIZE];
+    long nread;
+    while ((nread = syscall(SYS_getdents64, item->srcfd, buf, DIRBUFSIZE)) > 0) {
+        for (long pos = 0; pos < nread; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (buf + pos);
+            pos += d->d_reclen;
+            if (d->d_name[0]=='.' && (d->d_name[1]==0 || (d->d_name[1]=='.' && d->d_name[2]==0))) {
+                continue;
+            }
+            Item *child = new Item;
+            if (fstatat(item->srcfd, d->d_name, &child->st, AT_SYMLINK_NOFOLLOW)) {
+                error(errno);
+                delete child;
+                continue;
+            }
+            child->parent = item;
+            child->name = d->d_name;
+            child->srcfd = child->dstfd = -1;
+            child->refs = 1;
+            item->refs++;
+            pool->push(child, worker);
+        }
+    }
+    if (nread < 0) {
+        error(errno);
+    }
+
+    release(item);
+}
+
+/*
+ * copy files, symlinks and special files
+ */
+void MoveTree::copyother(Item *item)
+{
+    int srcparent = item->parent ? item->parent->srcfd : AT_FDCWD;
+    int dstparent = item->parent ? item->parent->dstfd : AT_FDCWD;
+    const char *dstname = item->parent ? item->name.c_str() : target.c_str();
+    const struct stat &st = item->st;
+
+    if (S_ISREG(st.st_mode)) {
+        int out = -1;
+        if (st.st_nlink > 1) {
+            // recreate hard links, the first one we see gets the data
+            std::lock_guard<std::mutex> lock(linkmutex);
+            auto key = std::make_pair(st.st_dev, st.st_ino);
+            auto it = links.find(key);
+            if (it != links.end()) {
+                if (linkat(AT_FDCWD, it->second.c_str(), dstparent, dstname, 0)) {
+                    error(errno);
+                } else {
+                    files++;
+                }
+                return;
+            }
+            out = openat(dstparent, dstname, O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_CLOEXEC, 0600);
+            if (out >= 0) links[key] = dstpath(item);
+        } else {
+            out = openat(dstparent, dstname, O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_CLOEXEC, 0600);
+        }
+        if (out < 0) {
+            error(errno);
+            return;
+        }
+        if (!item->parent) rootcreated = true;
+        int in = openat(srcparent, item->name.c_str(), O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+        if (in < 0) {
+            error(errno);
+            close(out);
+            return;
+        }
+        if (copydata(in, out, st.st_size)) {
+            copymeta(in, out, st);
+            files++;
+        }
+        close(in);
+        if (close(out)) {
+            error(errno);
+        }
+    } else if (S_ISLNK(st.st_mode)) {
+        vector<char> link(st.st_size + 1);
+        ssize_t len = readlinkat(srcparent, item->name.c_str(), link.data(), link.size());
+        if (len < 0 || (size_t)len >= link.size()) {
+            error(len < 0 ? errno : ENAMETOOLONG);
+            return;
+        }
+        link[len] = 0;
+        if (symlinkat(link.data(), dstparent, dstname)) {
+            error(errno);
+            return;
+        }
+        if (fchownat(dstparent, dstname, st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW) && errno != EPERM) {
+            error(errno);
+        }
+        struct timespec ts[2] = { st.st_atim, st.st_mtim };
+        utimensat(dstparent, dstname, ts, AT_SYMLINK_NOFOLLOW);
+        files++;
+    } else {
+        // fifos, sockets and devices
+        if (mknodat(dstparent, dstname, st.st_mode, st.st_rdev)) {
+            error(errno);
+            return;
+        }
+        if (fchownat(dstparent, dstname, st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW) && errno != EPERM) {
+            error(errno);
+        }
+        if (fchmodat(dstparent, dstname, st.st_mode & 07777, 0)) {
+            error(errno);
+        }
+        struct timespec ts[2] = { st.st_atim, st.st_mtim };
+        utimensat(dstparent, dstname, ts, AT_SYMLINK_NOFOLLOW);
+        files++;
+    }
+}
+
+/*
+ * copy file content, copy_file_range if possible, sendfile or read/write otherwise
+ */
+bool MoveTree::copydata(int in, int out, off_t size)
+{
+    enum { COPYRANGE, SENDFILE, READWRITE } method = COPYRANGE;
+    vector<char> buf;
+    off_t copied = 0;
+
+    while (true) {
+        ssize_t n;
+        if (method == COPYRANGE) {
+#ifdef SYS_copy_file_range
+            n = syscall(SYS_copy_file_range, in, NULL, out, NULL, COPYCHUNK, 0);
+#else
+            n = -1;
+            errno = ENOSYS;
+#endif
+            // not supported by kernel or between these filesystems
+            if (n < 0 && copied == 0 && (errno==EXDEV || errno==ENOSYS || errno==EINVAL || errno==EOPNOTSUPP || errno==EBADF)) {
+                method = SENDFILE;
+                continue;
+            }
+        } else if (method == SENDFILE) {
+            n = sendfile(out, in, NULL, COPYCHUNK);
+            if (n < 0 && copied == 0 && (errno==EINVAL || errno==ENOSYS)) {
+                method = READWRITE;
+                continue;
+            }
+        } else {
+            if (buf.empty()) buf.resize(BUFSIZE);
+            n = read(in, buf.data(), buf.size());
+            for (ssize_t written = 0; n > 0 && written < n; ) {
+                ssize_t w = write(out, buf.data() + written, n - written);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    n = -1;
+                    break;
+                }
+                written += w;
+            }
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error(errno);
+            return false;
+        }
+        if (n == 0) break;
+        copied += n;
+        bytes += n;
+    }
+
+    // file changed while we copied it, report it but keep going
+    if (copied != size) {
+        cerr << "Warning: size of file changed during copy" << endl;
+    }
+    return true;
+}
+
+/*
+ * owner, mode, extended attributes (ACLs are stored as system.posix_acl_*) and timestamps,
+ * in this order, as chown clears setuid bits and ACLs change the mode
+ */
+void MoveTree::copymeta(int in, int out, const struct stat &st)
+{
+    if (fchown(out, st.st_uid, st.st_gid) && errno != EPERM) {
+        error(errno);
+    }
+    if (fchmod(out, st.st_mode & 07777)) {
+        error(errno);
+    }
+
+    ssize_t len = flistxattr(in, NULL, 0);
+    if (len > 0) {
+        vector<char> names(len);
+        len = flistxattr(in, names.data(), names.size());
+        for (ssize_t pos = 0; pos < len; pos += strlen(names.data() + pos) + 1) {
+            const char *name = names.data() + pos;
+            ssize_t vlen = fgetxattr(in, name, NULL, 0);
+            if (vlen < 0) continue;
+            vector<char> value(vlen + 1);
+            vlen = fgetxattr(in, name, value.data(), value.size());
+            if (vlen < 0) continue;
+            // trusted.* and security.* may not be settable, and target may not support xattrs
+            if (fsetxattr(out, name, value.data(), vlen, 0) && errno != ENOTSUP && errno != EPERM) {
+                error(errno);
+            }
+        }
+    }
+
+    struct timespec ts[2] = { st.st_atim, st.st_mtim };
+    if (futimens(out, ts)) {
+        error(errno);
+    }
+}
+
+/*
+ * drop a reference, last one finishes the directory and drops the reference to its parent
+ */
+void MoveTree::release(Item *item)
+{
+    while (item && --item->refs == 0) {
+        Item *parent = item->parent;
+        copymeta(item->srcfd, item->dstfd, item->st);
+        dirs++;
+        close(item->srcfd);
+        close(item->dstfd);
+        delete item;
+        item = parent;
+    }
+}
+
+/*
+ * full path of target of an item, only needed for hard links
+ */
+string MoveTree::dstpath(Item *item)
+{
+    if (!item->parent) return target;
+    return dstpath(item->parent) + "/" + item->name;
+}
+
+MoveStats MoveTree::getstats()
+{
+    MoveStats s;
+    s.files = files;
+    s.dirs = dirs;
+    s.bytes = bytes;
+    s.errors = errors;
+    s.seconds = seconds;
+    return s;
+}
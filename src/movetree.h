@@ -0,0 +1,105 @@
+#ifndef MOVETREE_H
+#define MOVETREE_H
+
+/*
+ *  workspace++
+ *
+ *  move directory trees between filesystems, used if rename() fails with EXDEV
+ *
+ *  the tree is copied by a pool of work stealing threads, file data is copied with
+ *  copy_file_range, falling back to sendfile and buffered copies. Ownership, modes,
+ *  extended attributes (including ACLs) and timestamps are kept, hard links are
+ *  recreated. The source is removed only after the whole copy succeeded.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+#include <sys/stat.h>
+
+#include "workpool.h"
+
+using namespace std;
+
+
+/*
+ * counters of a move
+ */
+struct MoveStats {
+    long files;
+    long dirs;
+    unsigned long long bytes;
+    long errors;
+    double seconds;
+};
+
+
+class MoveTree {
+
+private:
+    // a directory or a file to copy, directories are kept until all children are done
+    struct Item {
+        Item *parent;
+        string name;
+        struct stat st;
+        int srcfd;
+        int dstfd;
+        std::atomic<long> refs;
+    };
+
+    int nthreads;
+    int progress;
+    string target;
+    std::atomic<bool> rootcreated;
+    std::atomic<long> files, dirs, errors;
+    std::atomic<unsigned long long> bytes;
+    std::atomic<int> firsterror;
+    double seconds;
+    WorkPool<Item*> *pool;
+
+    // hard links, first target path by device and inode
+    std::mutex linkmutex;
+    std::map<std::pair<dev_t, ino_t>, string> links;
+
+    void process(Item *item, int worker);
+    void copydir(Item *item, int worker);
+    void copyother(Item *item);
+    bool copydata(int in, int out, off_t size);
+    void release(Item *item);
+    void copymeta(int in, int out, const struct stat &st);
+    string dstpath(Item *item);
+    void error(int err);
+
+public:
+    // threads: number of copy threads, progress: seconds between progress messages, 0 for none
+    MoveTree(int threads, int progress=0);
+
+    // copy source to target (which may not exist) and remove source afterwards
+    // returns 0 on success, otherwise an errno value, source is untouched if copy failed
+    int move(const string source, const string target);
+
+    MoveStats getstats();
+};
+
+#endif
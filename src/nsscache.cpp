@@ -0,0 +1,251 @@
+/*
+ *  workspace++
+ *
+ *  node local cache of group lookups
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <sys/stat.h>
+
+#ifndef SETUID
+#include <sys/capability.h>
+#include "fscred.h"
+#endif
+
+#include "nsscache.h"
+#include "trustedfile.h"
+
+using namespace std;
+
+static string cachedir;
+static int ttl = 300;
+static uid_t trusteduid = 0;
+static bool capwrite = false;
+static long hits = 0, misses = 0;
+
+// lookups already done in this process, with the time they were done
+static map<pair<string, gid_t>, pair<time_t, vector<NssGroup> > > usercache;
+static map<gid_t, pair<time_t, string> > groupcache;
+
+
+/*
+ * entries of the process local cache expire like the files, which only matters
+ * for long running processes like wsd
+ */
+static bool valid(time_t stamp)
+{
+    time_t now = time(NULL);
+    return stamp <= now && now - stamp < ttl;
+}
+
+
+/*
+ * file or directory may only be changed by root or the DB user
+ */
+static bool trusted(const struct stat &st)
+{
+    return (st.st_uid == 0 || st.st_uid == trusteduid) && !(st.st_mode & (S_IWGRP|S_IWOTH));
+}
+
+void NssCache::setup(const string _cachedir, const int _ttl, const uid_t _trusteduid, const bool _capwrite)
+{
+    cachedir = _cachedir;
+    ttl = _ttl;
+    trusteduid = _trusteduid;
+    capwrite = _capwrite;
+
+    struct stat st;
+    if (cachedir != "" && (stat(cachedir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || !trusted(st))) {
+        cachedir = "";
+    }
+}
+
+
+/*
+ * read a cache file, false if missing, untrusted, broken or too old
+ */
+bool NssCache::readfile(const string filename, vector<NssGroup> &groups)
+{
+    int fd = open(filename.c_str(), O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || !trusted(st) || st.st_size > 1024*1024) {
+        close(fd);
+        return false;
+    }
+    string content(st.st_size, '\0');
+    bool ok = read(fd, &content[0], st.st_size) == st.st_size;
+    close(fd);
+    if (!ok) return false;
+
+    istringstream in(content);
+    string line;
+    if (!getline(in, line) || line != "wsnss 1") return false;
+    if (!getline(in, line)) return false;
+    time_t stamp = atol(line.c_str());
+    time_t now = time(NULL);
+    if (stamp > now || now - stamp >= ttl) return false;
+
+    groups.clear();
+    while (getline(in, line)) {
+        size_t space = line.find(' ');
+        if (space == string::npos) return false;
+        NssGroup g;
+        g.gid = strtoul(line.c_str(), NULL, 10);
+        g.name = line.substr(space + 1);
+        groups.push_back(g);
+    }
+    return true;
+}
+
+/*
+ * write a cache file by renaming a temporary file over it, errors are ignored,
+ * without the cache we just ask NSS again next time
+ */
+void NssCache::writefile(const string filename, const vector<NssGroup> &groups)
+{
+    uid_t euid = geteuid();
+    bool asuser = euid != 0 && euid != trusteduid;
+#ifdef SETUID
+    if (asuser) return;
+#else
+    // the capability build runs as the user, the file is given to the DB user
+    if (asuser && !capwrite) return;
+#endif
+
+    ostringstream out;
+    out << "wsnss 1\n" << time(NULL) << "\n";
+    for (auto const &g : groups) {
+        out << g.gid << " " << g.name << "\n";
+    }
+    string content = out.str();
+
+    size_t slash = filename.rfind('/');
+    if (slash == string::npos) return;
+#ifndef SETUID
+    CapScope caps(asuser ? initializer_list<int>{CAP_DAC_OVERRIDE, CAP_CHOWN} : initializer_list<int>{},
+                  __LINE__, __FILE__);
+#endif
+    int dirfd = open(filename.substr(0, slash).c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dirfd < 0) return;
+    // readers only trust files of root or the DB user, the user must never own the file,
+    // not even before it is complete, or it could be opened for writing in that moment
+    writetrusted(dirfd, filename.substr(slash + 1), content, asuser ? trusteduid : (uid_t)-1, (gid_t)-1);
+    close(dirfd);
+}
+
+
+vector<NssGroup> NssCache::getgroups(const string user, const gid_t gid)
+{
+    auto key = make_pair(user, gid);
+    auto it = usercache.find(key);
+    if (it != usercache.end() && valid(it->second.first)) {
+        hits++;
+        return it->second.second;
+    }
+
+    vector<NssGroup> groups;
+    // user names can not contain /, but better safe than sorry
+    string filename;
+    if (cachedir != "" && user.find('/') == string::npos && user[0] != '.') {
+        filename = cachedir + "/user-" + user + "-" + to_string(gid);
+    }
+    if (filename != "" && readfile(filename, groups)) {
+        hits++;
+    } else {
+        misses++;
+        // grow the list until all groups fit
+        int ngroups = 64;
+        vector<gid_t> gids(ngroups);
+        while (getgrouplist(user.c_str(), gid, gids.data(), &ngroups) == -1) {
+            if (ngroups <= (int)gids.size()) ngroups = gids.size() * 2;
+            gids.resize(ngroups);
+        }
+        gids.resize(ngroups);
+        groups.clear();
+        for (auto g : gids) {
+            NssGroup ng;
+            ng.gid = g;
+            struct group *grp = getgrgid(g);
+            if (grp) ng.name = grp->gr_name;
+            groups.push_back(ng);
+        }
+        if (filename != "") writefile(filename, groups);
+    }
+
+    time_t now = time(NULL);
+    for (auto const &g : groups) {
+        groupcache[g.gid] = make_pair(now, g.name);
+    }
+    usercache[key] = make_pair(now, groups);
+    return groups;
+}
+
+string NssCache::getgroupname(const gid_t gid)
+{
+    auto it = groupcache.find(gid);
+    if (it != groupcache.end() && valid(it->second.first)) {
+        hits++;
+        return it->second.second;
+    }
+
+    vector<NssGroup> groups;
+    string filename;
+    if (cachedir != "") {
+        filename = cachedir + "/group-" + to_string(gid);
+    }
+    string name;
+    if (filename != "" && readfile(filename, groups) && groups.size() == 1 && groups[0].gid == gid) {
+        hits++;
+        name = groups[0].name;
+    } else {
+        misses++;
+        struct group *grp = getgrgid(gid);
+        if (grp) name = grp->gr_name;
+        if (filename != "") {
+            NssGroup g;
+            g.gid = gid;
+            g.name = name;
+            writefile(filename, vector<NssGroup>(1, g));
+        }
+    }
+    groupcache[gid] = make_pair(time(NULL), name);
+    return name;
+}
+
+void NssCache::getstats(long &_hits, long &_misses)
+{
+    _hits = hits;
+    _misses = misses;
+}
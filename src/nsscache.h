@@ -0,0 +1,79 @@
+#ifndef NSSCACHE_H
+#define NSSCACHE_H
+
+/*
+ *  workspace++
+ *
+ *  node local cache of group lookups
+ *
+ *  getgrouplist and getgrgid go to SSSD/LDAP on most clusters, and many jobs starting at
+ *  the same time ask the same questions. The results for a user (all groups with their
+ *  names) are kept in memory and, if a cache directory is configured (nsscache), in one
+ *  file per user and group, both valid for nsscache_ttl seconds.
+ *
+ *  Cache files are only trusted if they and the directory are owned by root or the DB user
+ *  and are not writable by group or others. Only root or the DB user write them, using
+ *  rename of a temporary file, so readers never see partial files. The capability build
+ *  writes them as the user and gives them to the DB user before they get a name
+ *  (trustedfile.h).
+ *
+ *  file format (text):
+ *    wsnss 1
+ *    <time of lookup>
+ *    <gid> <name>        one line per group, name empty if gid has no name
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+using namespace std;
+
+struct NssGroup {
+    gid_t gid;
+    string name;        // empty if the gid has no name
+};
+
+
+class NssCache {
+
+private:
+    static bool readfile(const string filename, vector<NssGroup> &groups);
+    static void writefile(const string filename, const vector<NssGroup> &groups);
+
+public:
+    // cachedir empty disables the files, the process local cache is always used,
+    // trusteduid is the DB user, which may own and write cache files besides root,
+    // capwrite lets the capability build write them with CAP_DAC_OVERRIDE and CAP_CHOWN,
+    // only for callers that kept both
+    static void setup(const string cachedir, const int ttl, const uid_t trusteduid, const bool capwrite=false);
+
+    // all groups of user, base group gid included, any number of groups
+    static vector<NssGroup> getgroups(const string user, const gid_t gid);
+
+    // name of group gid, empty if it has none
+    static string getgroupname(const gid_t gid);
+
+    // lookups served from cache and lookups which needed NSS
+    static void getstats(long &hits, long &misses);
+};
+
+#endif
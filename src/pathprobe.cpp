@@ -0,0 +1,182 @@
+/*
+ *  workspace++
+ *
+ *  concurrent checks of paths with timeout
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <time.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/wait.h>
+
+#include "pathprobe.h"
+
+using namespace std;
+
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * the check itself
+ */
+static ProbeResult check(const string &path, const ProbeKind kind)
+{
+    ProbeResult r;
+    double t0 = now();
+    r.done = true;
+    r.freebytes = r.totalbytes = r.freeinodes = r.totalinodes = 0;
+    if (kind == PROBE_STATFS) {
+        struct statfs sfs;
+        r.exists = statfs(path.c_str(), &sfs) == 0;
+        r.error = r.exists ? 0 : errno;
+        if (r.exists) {
+            r.freebytes = (uint64_t)sfs.f_bsize * sfs.f_bfree;
+            r.totalbytes = (uint64_t)sfs.f_bsize * sfs.f_blocks;
+            r.freeinodes = sfs.f_ffree;
+            r.totalinodes = sfs.f_files;
+        }
+    } else {
+        struct stat st;
+        r.exists = stat(path.c_str(), &st) == 0;
+        r.error = (r.exists || errno == ENOENT) ? 0 : errno;
+    }
+    r.seconds = now() - t0;
+    return r;
+}
+
+
+PathProbe::PathProbe(const vector<string> &paths, const ProbeKind _kind) : kind(_kind)
+{
+    start = now();
+    // a single DB has nothing to be checked next to, the fork would only add its cost,
+    // a free space check still needs the timeout to leave a hanging space out
+    bool inplace = paths.size() == 1 && kind == PROBE_STAT;
+    for (auto const &path : paths) {
+        Probe p;
+        p.pid = -1;
+        p.fd = -1;
+        p.finished = false;
+        int fds[2];
+        if (!inplace && pipe2(fds, O_CLOEXEC) == 0) {
+            p.pid = fork();
+            if (p.pid == 0) {
+                close(fds[0]);
+                // a hanging child must not keep the pipes of our caller open
+                int null = open("/dev/null", O_RDWR);
+                if (null >= 0) {
+                    dup2(null, 0);
+                    dup2(null, 1);
+                    dup2(null, 2);
+                }
+                ProbeResult r = check(path, kind);
+                if (write(fds[1], &r, sizeof(r))) {};
+                _exit(0);
+            }
+            close(fds[1]);
+            if (p.pid > 0) {
+                p.fd = fds[0];
+            } else {
+                close(fds[0]);
+            }
+        }
+        if (p.pid < 0) {
+            // single path or no process, check in place
+            p.result = check(path, kind);
+            p.finished = true;
+        }
+        probes.push_back(p);
+    }
+}
+
+PathProbe::~PathProbe()
+{
+    for (auto &p : probes) {
+        if (p.fd >= 0) close(p.fd);
+        // hanging children are left behind, they get reaped after we are gone
+        if (p.pid > 0 && !p.finished) waitpid(p.pid, NULL, WNOHANG);
+    }
+}
+
+/*
+ * read result of finished child and reap it
+ */
+void PathProbe::collect(Probe &p)
+{
+    ProbeResult r;
+    if (read(p.fd, &r, sizeof(r)) == sizeof(r)) {
+        p.result = r;
+        p.result.done = true;
+    } else {
+        // child died, treat as not existing like fs::exists with error
+        p.result.done = true;
+        p.result.exists = false;
+        p.result.error = EIO;
+        p.result.freebytes = p.result.totalbytes = p.result.freeinodes = p.result.totalinodes = 0;
+        p.result.seconds = now() - start;
+    }
+    close(p.fd);
+    p.fd = -1;
+    waitpid(p.pid, NULL, 0);
+    p.finished = true;
+}
+
+ProbeResult PathProbe::wait(const size_t i, const double timeout)
+{
+    Probe &p = probes[i];
+    while (!p.finished) {
+        int ms = -1;
+        if (timeout > 0) {
+            // after the deadline, results which are already there are still taken
+            double left = start + timeout - now();
+            ms = left > 0 ? (int)(left * 1000) + 1 : 0;
+        }
+        struct pollfd pfd;
+        pfd.fd = p.fd;
+        pfd.events = POLLIN;
+        int ret = poll(&pfd, 1, ms);
+        if (ret > 0 || (ret < 0 && errno != EINTR)) {
+            collect(p);
+        } else if (ret == 0 && ms == 0) {
+            ProbeResult r;
+            r.done = false;
+            r.exists = false;
+            r.error = ETIMEDOUT;
+            r.seconds = now() - start;
+            r.freebytes = r.totalbytes = r.freeinodes = r.totalinodes = 0;
+            return r;
+        }
+    }
+    return p.result;
+}
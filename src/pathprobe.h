@@ -0,0 +1,82 @@
+#ifndef PATHPROBE_H
+#define PATHPROBE_H
+
+/*
+ *  workspace++
+ *
+ *  concurrent checks of paths with timeout, stat() for existence of DB entries and
+ *  statfs() for free space of workspace spaces
+ *
+ *  a hanging filesystem (NFS, Lustre) would block a stat() forever, in uninterruptible
+ *  sleep, and with it the whole tool. Each check runs in its own child process, the parent
+ *  waits with a deadline and leaves hanging children behind. Processes and not threads are
+ *  used, as a thread hanging in the kernel would also block the setuid/seteuid calls of
+ *  the parent, which glibc synchronizes over all threads.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+using namespace std;
+
+enum ProbeKind {
+    PROBE_STAT,         // does path exist
+    PROBE_STATFS        // free space of filesystem of path
+};
+
+struct ProbeResult {
+    bool done;          // false if timed out
+    bool exists;        // PROBE_STATFS: statfs succeeded
+    int error;          // errno, 0 if exists or ENOENT for PROBE_STAT
+    double seconds;     // time of check, or time waited if timed out
+    // PROBE_STATFS only, inodes are 0 for filesystems without inode limit
+    uint64_t freebytes, totalbytes;
+    uint64_t freeinodes, totalinodes;
+};
+
+
+class PathProbe {
+
+private:
+    struct Probe {
+        pid_t pid;
+        int fd;
+        bool finished;
+        ProbeResult result;
+    };
+    vector<Probe> probes;
+    double start;
+    ProbeKind kind;
+
+    void collect(Probe &p);
+
+public:
+    // starts checks for all paths at once, a single PROBE_STAT is done in place
+    PathProbe(const vector<string> &paths, const ProbeKind kind = PROBE_STAT);
+    ~PathProbe();
+
+    // result of check i, waits until timeout seconds after start, timeout <= 0 waits forever
+    ProbeResult wait(const size_t i, const double timeout);
+};
+
+#endif
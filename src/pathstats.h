@@ -0,0 +1,53 @@
+#ifndef PATHSTATS_H
+#define PATHSTATS_H
+
+/*
+ *  workspace++
+ *
+ *  count of path lookups, for --debug
+ *
+ *  every component of a path is a lookup, and on Lustre or NFS each lookup not in the
+ *  client cache is a round trip to the metadata server. allocate, release and restore
+ *  open the space and DB directories once and do the rest with the *at calls relative to
+ *  them, this counts system calls resolving a whole path and those resolving a single
+ *  name in an open directory, to see that it stays that way.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+
+
+class PathStats {
+
+public:
+    // system calls resolving a whole path
+    static std::atomic<long> &paths() {
+        static std::atomic<long> n(0);
+        return n;
+    }
+
+    // system calls resolving a name relative to an open directory
+    static std::atomic<long> &names() {
+        static std::atomic<long> n(0);
+        return n;
+    }
+};
+
+#endif
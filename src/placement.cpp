@@ -0,0 +1,306 @@
+/*
+ *  workspace++
+ *
+ *  placement of new workspaces on the spaces of a filesystem
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "placement.h"
+#include "spacecache.h"
+#include "wsindex.h"
+
+using namespace std;
+
+
+static int select_random(const vector<SpaceInfo> &spaces, const PlacementRequest &)
+{
+    double total = 0;
+    for (auto const &s : spaces) {
+        if (s.usable) total += s.weight;
+    }
+    if (total <= 0) return -1;
+    double r = rand() / (RAND_MAX + 1.0) * total;
+    int last = -1;
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!spaces[i].usable) continue;
+        last = i;
+        if (r < spaces[i].weight) break;
+        r -= spaces[i].weight;
+    }
+    return last;
+}
+
+// id modulo number of spaces like always, so nobody moves as long as nothing is excluded
+static int select_modulo(const vector<SpaceInfo> &spaces, const unsigned long id)
+{
+    for (size_t k = 0; k < spaces.size(); k++) {
+        size_t i = (id + k) % spaces.size();
+        if (spaces[i].usable) return i;
+    }
+    return -1;
+}
+
+static int select_uid(const vector<SpaceInfo> &spaces, const PlacementRequest &req)
+{
+    return select_modulo(spaces, req.uid);
+}
+
+static int select_gid(const vector<SpaceInfo> &spaces, const PlacementRequest &req)
+{
+    return select_modulo(spaces, req.gid);
+}
+
+// splitmix64 finalizer, spreads similar uids over the whole range
+static uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a of the path, the score of a space must not depend on its position in the config
+static uint64_t hashpath(const string &path)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : path) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+ * weighted rendezvous hashing: each space gets a pseudo random score per uid, the space
+ * with the highest score wins. -weight/ln(u) with u uniform in (0,1) gives each space
+ * a share proportional to its weight.
+ */
+static int select_rendezvous(const vector<SpaceInfo> &spaces, const PlacementRequest &req)
+{
+    int best = -1;
+    double bestscore = 0;
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!spaces[i].usable) continue;
+        uint64_t h = mix64(hashpath(spaces[i].space) ^ mix64(req.uid));
+        double u = ((h >> 11) + 0.5) / 9007199254740992.0;   // 2^53
+        double score = -spaces[i].weight / log(u);
+        if (best < 0 || score > bestscore) {
+            best = i;
+            bestscore = score;
+        }
+    }
+    return best;
+}
+
+static int select_mostspace(const vector<SpaceInfo> &spaces, const PlacementRequest &)
+{
+    int best = -1;
+    double bestscore = 0;
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!spaces[i].usable) continue;
+        double score = spaces[i].freebytes * spaces[i].weight;
+        if (best < 0 || score > bestscore) {
+            best = i;
+            bestscore = score;
+        }
+    }
+    return best;
+}
+
+static int select_mostinodes(const vector<SpaceInfo> &spaces, const PlacementRequest &)
+{
+    int best = -1;
+    double bestscore = 0;
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!spaces[i].usable) continue;
+        // filesystems without inode limit report 0 inodes, they can not run out of them
+        double score = spaces[i].totalinodes == 0 ? HUGE_VAL : spaces[i].freeinodes * spaces[i].weight;
+        if (best < 0 || score > bestscore) {
+            best = i;
+            bestscore = score;
+        }
+    }
+    return best;
+}
+
+static int select_leastworkspaces(const vector<SpaceInfo> &spaces, const PlacementRequest &)
+{
+    int best = -1;
+    double bestscore = 0;
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!spaces[i].usable) continue;
+        double score = spaces[i].workspaces / spaces[i].weight;
+        if (best < 0 || score < bestscore) {
+            best = i;
+            bestscore = score;
+        }
+    }
+    return best;
+}
+
+static const PlacementPolicy policies[] = {
+    // name               select                   samples counts
+    { "random",           select_random,           false,  false },
+    { "uid",              select_uid,              false,  false },
+    { "gid",              select_gid,              false,  false },
+    { "rendezvous",       select_rendezvous,       false,  false },
+    { "mostspace",        select_mostspace,        true,   false },
+    { "mostinodes",       select_mostinodes,       true,   false },
+    { "leastworkspaces",  select_leastworkspaces,  false,  true  },
+};
+
+
+const PlacementPolicy *Placement::getpolicy(const string name)
+{
+    for (auto const &p : policies) {
+        if (name == p.name) return &p;
+    }
+    return NULL;
+}
+
+/*
+ * count the workspaces of each space from the DB index, false if it is not up to date,
+ * reading all DB entries instead would cost more than the allocation itself
+ */
+bool Placement::countworkspaces(const FilesystemConfig &fs, vector<SpaceInfo> &infos, const bool debug)
+{
+    // read only, without the lock of the writers, an index changed meanwhile is just older
+    WsIndexReader index(fs.database);
+    if (!index.isvalid()) {
+        if (debug) {
+            cerr << "debug: no up to date index in " << fs.database << ", workspaces not counted" << endl;
+        }
+        return false;
+    }
+    for (auto &info : infos) {
+        info.workspaces = 0;
+    }
+    for (uint64_t i = 0; i < index.size(); i++) {
+        string dir = index.get(i).workspace;
+        for (auto &info : infos) {
+            if (dir.compare(0, info.space.size(), info.space) == 0 && dir.size() > info.space.size() &&
+                    dir[info.space.size()] == '/') {
+                info.workspaces++;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+
+int Placement::choose(const FilesystemConfig &fs, const uid_t uid, const gid_t gid, const bool debug)
+{
+    const PlacementPolicy *policy = getpolicy(fs.spaceselection);
+    if (!policy) policy = getpolicy("random");
+
+    vector<SpaceInfo> infos(fs.spaces.size());
+    for (size_t i = 0; i < fs.spaces.size(); i++) {
+        SpaceInfo &info = infos[i];
+        info.space = fs.spaces[i];
+        info.weight = i < fs.spaceweights.size() ? fs.spaceweights[i] : 1.0;
+        info.freebytes = info.totalbytes = info.freeinodes = info.totalinodes = 0;
+        info.workspaces = -1;
+        // weight 0 takes a space out of placement, existing workspaces stay usable
+        info.usable = info.weight > 0;
+        if (!info.usable && debug) {
+            cerr << "debug: space " << info.space << " excluded: weight is 0" << endl;
+        }
+    }
+
+    if (policy->needsamples || fs.highwatermark > 0) {
+        // all spaces at once, and only once for many allocations in a short time
+        bool cached;
+        vector<SpaceSample> samples = SpaceCache::getfree(fs.name, fs.spaces, fs.statfs_timeout, cached);
+        for (size_t i = 0; i < samples.size(); i++) {
+            SpaceInfo &info = infos[i];
+            info.freebytes = samples[i].freebytes;
+            info.totalbytes = samples[i].totalbytes;
+            info.freeinodes = samples[i].freeinodes;
+            info.totalinodes = samples[i].totalinodes;
+            if (!info.usable) continue;
+            if (samples[i].error) {
+                info.usable = false;
+                if (debug) {
+                    cerr << "debug: space " << info.space << " excluded: " << strerror(samples[i].error) << endl;
+                }
+                // log only when sampled, not for every reuse of a cached sample
+                if (!cached) {
+                    syslog(LOG_INFO, "space <%s> excluded from selection: %s.", info.space.c_str(),
+                           strerror(samples[i].error));
+                }
+                continue;
+            }
+            double usedbytes = info.totalbytes ? 100.0 * (info.totalbytes - info.freebytes) / info.totalbytes : 0;
+            double usedinodes = info.totalinodes ? 100.0 * (info.totalinodes - info.freeinodes) / info.totalinodes : 0;
+            if (debug) {
+                cerr << "debug: space " << info.space << " has " << info.freebytes << " bytes and "
+                     << info.freeinodes << " inodes free, " << usedbytes << "% and " << usedinodes << "% used"
+                     << (cached ? " (cached)" : "") << endl;
+            }
+            if (fs.highwatermark > 0 && (usedbytes >= fs.highwatermark || usedinodes >= fs.highwatermark)) {
+                info.usable = false;
+                if (debug) {
+                    cerr << "debug: space " << info.space << " excluded: above highwatermark of "
+                         << fs.highwatermark << "%" << endl;
+                }
+                if (!cached) {
+                    syslog(LOG_INFO, "space <%s> excluded from selection: above highwatermark.", info.space.c_str());
+                }
+            }
+        }
+    }
+
+    if (policy->needcounts) {
+        if (countworkspaces(fs, infos, debug)) {
+            if (debug) {
+                for (auto const &info : infos) {
+                    cerr << "debug: space " << info.space << " has " << info.workspaces << " workspaces" << endl;
+                }
+            }
+        } else {
+            policy = getpolicy("random");
+        }
+    }
+
+    srand(time(NULL));
+    PlacementRequest req;
+    req.uid = uid;
+    req.gid = gid;
+    int spaceid = policy->select(infos, req);
+    if (spaceid < 0) {
+        cerr << "Error: none of the spaces of this workspace is usable." << endl;
+        exit(-1);
+    }
+    if (debug) {
+        cerr << "debug: spaceselection " << policy->name << " chose " << infos[spaceid].space << endl;
+    }
+    return spaceid;
+}
@@ -0,0 +1,91 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+/*
+ *  workspace++
+ *
+ *  placement of new workspaces on the spaces of a filesystem (spaceselection)
+ *
+ *  a policy gets the state of all spaces and returns the index of the space to use,
+ *  spaces excluded before (statfs failed, above highwatermark) are marked not usable.
+ *  Free space is only sampled if the policy or the watermark needs it, numbers of
+ *  workspaces only for leastworkspaces. Policies:
+ *    random           random space, chances proportional to the weight
+ *    uid, gid         uid or gid modulo number of spaces, next usable one if excluded
+ *    rendezvous       weighted rendezvous hashing of uid, adding a space moves only
+ *                     about 1/N of the users, removing one only its own users
+ *    mostspace        most free bytes * weight
+ *    mostinodes       most free inodes * weight
+ *    leastworkspaces  least workspaces in DB / weight
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "wsconfig.h"
+
+using namespace std;
+
+// state of one space as seen by a policy
+struct SpaceInfo {
+    string space;
+    double weight;
+    uint64_t freebytes, totalbytes;     // 0 if not sampled
+    uint64_t freeinodes, totalinodes;   // 0 if not sampled or no inode limit
+    long workspaces;                    // -1 if not counted
+    bool usable;
+};
+
+struct PlacementRequest {
+    uid_t uid;
+    gid_t gid;
+};
+
+// returns index of chosen space, or -1 if none of the usable spaces fits
+typedef int (*PlacementFunc)(const vector<SpaceInfo> &spaces, const PlacementRequest &req);
+
+struct PlacementPolicy {
+    const char *name;
+    PlacementFunc select;
+    bool needsamples;       // free bytes and inodes
+    bool needcounts;        // workspaces per space
+};
+
+
+class Placement {
+
+private:
+    static const PlacementPolicy *getpolicy(const string name);
+    static bool countworkspaces(const FilesystemConfig &fs, vector<SpaceInfo> &infos, const bool debug);
+
+public:
+    static bool known(const string name) {
+        return getpolicy(name) != NULL;
+    }
+
+    // index of the space of fs for a new workspace, unknown policies are random,
+    // exits with an error message if no space is usable
+    static int choose(const FilesystemConfig &fs, const uid_t uid, const gid_t gid, const bool debug);
+};
+
+#endif
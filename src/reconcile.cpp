@@ -0,0 +1,572 @@
+/*
+ *  workspace++
+ *
+ *  reconciliation of the spaces of a filesystem with its DB
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+
+#include <yaml-cpp/yaml.h>
+#include <boost/algorithm/string.hpp>
+
+#include "reconcile.h"
+#include "wsindex.h"
+
+using namespace std;
+
+// glibc only has a wrapper for getdents64 since 2.30
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+static const int DIRBUFSIZE = 64*1024;
+
+
+Reconciler::Reconciler(const FilesystemConfig &_fs, const int _dbuid, const int _dbgid)
+    : fs(_fs), dbuid(_dbuid), dbgid(_dbgid), memlimit(0), expire(false), fullscan(false), dbonly(false),
+      now(0), nextdue(0)
+{
+}
+
+void Reconciler::setfullscan(bool _fullscan)
+{
+    fullscan = _fullscan;
+}
+
+void Reconciler::setdbonly(bool _dbonly)
+{
+    dbonly = _dbonly;
+}
+
+void Reconciler::setexpire(bool _expire)
+{
+    expire = _expire;
+}
+
+void Reconciler::setexternal(size_t _memlimit, const string _tmpdir)
+{
+    memlimit = _memlimit;
+    tmpdir = _tmpdir;
+}
+
+ExternalSorter *Reconciler::newsorter()
+{
+    return new ExternalSorter(memlimit, tmpdir);
+}
+
+const char *Reconciler::classname(ReconcileClass what)
+{
+    switch (what) {
+        case RC_VALID: return "valid";
+        case RC_STRAY: return "stray";
+        case RC_VALID_REMOVED: return "validremoved";
+        case RC_STRAY_REMOVED: return "strayremoved";
+        case RC_KEEP: return "keep";
+        case RC_REMIND: return "remind";
+        case RC_EXPIRE: return "expire";
+        case RC_RESTORABLE: return "restorable";
+        case RC_DELETE: return "delete";
+        case RC_BROKEN: return "broken";
+    }
+    return "unknown";
+}
+
+/*
+ * names like the glob *-* of ws_expirer, a missing directory is empty
+ */
+void Reconciler::listdir(const string dir, const string skip, function<bool(const char *)> found)
+{
+    int fd = open(dir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (fd < 0) return;
+    char buf[DIRBUFSIZE];
+    long nread;
+    while ((nread = syscall(SYS_getdents64, fd, buf, DIRBUFSIZE)) > 0) {
+        for (long pos = 0; pos < nread; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (buf + pos);
+            pos += d->d_reclen;
+            if (d->d_name[0] == '.' || strchr(d->d_name, '-') == NULL) continue;
+            if (skip == d->d_name) continue;
+            if (!found(d->d_name)) {
+                close(fd);
+                return;
+            }
+        }
+    }
+    close(fd);
+}
+
+vector<string> Reconciler::listdir(const string dir, const string skip)
+{
+    vector<string> names;
+    listdir(dir, skip, [&names](const char *name) {
+        names.push_back(name);
+        return true;
+    });
+    sort(names.begin(), names.end());
+    return names;
+}
+
+void Reconciler::readentry(const string filename, ReconcileAction &a, int &reminder)
+{
+    a.workspace = "";
+    a.expiration = 0;
+    a.released = 0;
+    a.mailaddress = "";
+    reminder = 0;
+    try {
+        YAML::Node entry = YAML::LoadFile(filename);
+        if (entry.IsMap()) {
+            // incomplete entries still tell the workspace
+            a.workspace = entry["workspace"].as<string>("");
+            a.expiration = entry["expiration"].as<long>(0);
+            reminder = entry["reminder"].as<int>(0);
+            a.mailaddress = entry["mailaddress"].as<string>("");
+            a.released = entry["released"].as<long>(0);
+            return;
+        }
+    } catch (...) {
+    }
+    // old db format, python version
+    ifstream old(filename.c_str());
+    if (!(old >> a.expiration >> a.workspace)) {
+        a.expiration = 0;
+        a.workspace = "";
+    }
+}
+
+/*
+ * classified DB entries for external sort, fields separated by 0, path first to sort by it
+ */
+static string serialize(const ReconcileAction &a)
+{
+    string r = a.path;
+    r += '\0';
+    r += to_string(a.what);
+    r += '\0';
+    r += a.workspace;
+    r += '\0';
+    r += to_string(a.expiration);
+    r += '\0';
+    r += to_string(a.released);
+    r += '\0';
+    r += a.mailaddress;
+    return r;
+}
+
+static void deserialize(const string &r, ReconcileAction &a)
+{
+    vector<string> f;
+    size_t pos = 0, end;
+    while ((end = r.find('\0', pos)) != string::npos) {
+        f.push_back(r.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    f.push_back(r.substr(pos));
+    a.path = f[0];
+    a.what = (ReconcileClass)stoi(f[1]);
+    a.workspace = f[2];
+    a.expiration = stol(f[3]);
+    a.released = stol(f[4]);
+    a.mailaddress = f[5];
+}
+
+void Reconciler::addentry(vector<ReconcileAction> &v, ExternalSorter *sorter, const ReconcileAction &a)
+{
+    if (memlimit > 0) {
+        sorter->add(serialize(a));
+    } else {
+        v.push_back(a);
+    }
+}
+
+void Reconciler::addkey(const string &name, const string &wsname)
+{
+    if (memlimit > 0) {
+        dbkeys->add(name);
+        dbkeys->add(wsname);
+    } else {
+        dbnames.insert(name);
+        dbworkspaces.insert(wsname);
+    }
+}
+
+void Reconciler::addremoved(const string &name)
+{
+    if (memlimit > 0) {
+        extdbremoved->add(name);
+    } else {
+        dbremoved.insert(name);
+    }
+}
+
+/*
+ * class of a DB entry
+ */
+void Reconciler::classifyentry(ReconcileAction &a, int reminder)
+{
+    if (a.expiration == 0) {
+        a.what = RC_BROKEN;
+    } else if (now > a.expiration) {
+        a.what = RC_EXPIRE;
+    } else if (now > a.expiration - reminder * 24L * 3600) {
+        a.what = RC_REMIND;
+    } else {
+        a.what = RC_KEEP;
+    }
+}
+
+/*
+ * remember when a classified entry needs the expirer next, 1s after its time,
+ * as entries are due after their time
+ */
+void Reconciler::notedue(const ReconcileAction &a, int reminder)
+{
+    long when;
+    switch (a.what) {
+        case RC_KEEP:
+            when = a.expiration - max(reminder, 0) * 24L * 3600;
+            break;
+        case RC_REMIND:
+            when = a.expiration;
+            break;
+        case RC_RESTORABLE:
+            when = a.expiration + max(fs.keeptime, 0) * 24L * 3600;
+            if (a.released > 0) when = min(when, a.released + 3600);
+            break;
+        default:
+            // due now, or never
+            return;
+    }
+    if (nextdue == 0 || when + 1 < nextdue) nextdue = when + 1;
+}
+
+/*
+ * class of an entry in DB/deleted, false if the name is not user-name-timestamp
+ */
+bool Reconciler::classifydeleted(const string &name, ReconcileAction &a)
+{
+    size_t stamp = name.rfind('-');
+    if (stamp == string::npos || name.find('-') == stamp) return false;
+    char *end;
+    long released = strtol(name.c_str() + stamp + 1, &end, 10);
+    if (a.workspace == "" || a.expiration == 0 || *end != 0 || stamp + 1 == name.size()) {
+        a.what = RC_BROKEN;
+        return true;
+    }
+    // the deleted workspace has the name of the DB entry
+    a.workspace = a.workspace.substr(0, a.workspace.rfind('/') + 1) + fs.deleted + "/" + name;
+    a.expiration = released;
+    // released before 2001 makes no sense, ignore
+    if (a.released < 1000000000) a.released = 0;
+    if (now > a.expiration + max(fs.keeptime, 0) * 24L * 3600 ||
+            (a.released > 0 && now > a.released + 3600)) {
+        a.what = RC_DELETE;
+    } else {
+        a.what = RC_RESTORABLE;
+    }
+    return true;
+}
+
+ReconcileAction Reconciler::fromindex(const string &dir, const WsIndexEntry &e)
+{
+    ReconcileAction a;
+    a.path = dir + "/" + e.id;
+    a.workspace = e.workspace;
+    a.expiration = e.expiration;
+    a.released = e.released;
+    a.mailaddress = e.mailaddress;
+    return a;
+}
+
+/*
+ * index record agrees with what was read from the YAML file
+ */
+bool Reconciler::sameentry(const WsIndexReader &index, const string &name, const ReconcileAction &a, int reminder)
+{
+    WsIndexEntry e;
+    return index.find(name, e) && e.workspace == a.workspace && e.expiration == a.expiration &&
+           e.released == a.released && e.reminder == reminder && e.mailaddress == a.mailaddress;
+}
+
+/*
+ * sealed after each listing, so only one listing is in memory at a time
+ */
+bool Reconciler::sortdir(const string dir, const string skip, ExternalSorter *sorter)
+{
+    listdir(dir, skip, [sorter](const char *name) {
+        sorter->add(name);
+        return true;
+    });
+    sorter->seal();
+    return sorter->ok();
+}
+
+ReconcileError Reconciler::scan(const string space, string &error)
+{
+    spaces.clear();
+    for (auto const &s : fs.spaces) {
+        if (!dbonly && (space == "" || s == space)) spaces.push_back(s);
+    }
+
+    // (1) spaces first
+    workspaces.clear();
+    removed.clear();
+    extworkspaces.clear();
+    extremoved.clear();
+    for (auto const &s : spaces) {
+        if (memlimit > 0) {
+            extworkspaces.push_back(unique_ptr<ExternalSorter>(newsorter()));
+            extremoved.push_back(unique_ptr<ExternalSorter>(newsorter()));
+            if (!sortdir(s, fs.deleted, extworkspaces.back().get()) ||
+                    !sortdir(s + "/" + fs.deleted, "", extremoved.back().get())) {
+                error = "could not write temporary file in " + tmpdir;
+                return RE_TMPFILE;
+            }
+        } else {
+            workspaces.push_back(listdir(s, fs.deleted));
+            removed.push_back(listdir(s + "/" + fs.deleted, ""));
+        }
+    }
+
+    // a DB that is not mounted must not make all workspaces stray
+    ifstream magicfile(fs.database + "/.ws_db_magic");
+    string magic;
+    if (magicfile && getline(magicfile, magic)) {
+        boost::trim(magic);
+    }
+    if (magic != fs.name) {
+        error = "DB directory " + fs.database + " does not contain .ws_db_magic with workspace name in it";
+        return RE_MAGIC;
+    }
+
+    // (2) DB second
+    dbnames.clear();
+    dbworkspaces.clear();
+    dbremoved.clear();
+    entries.clear();
+    delentries.clear();
+    indexdiffs.clear();
+    if (memlimit > 0) {
+        dbkeys.reset(newsorter());
+        extdbremoved.reset(newsorter());
+        extentries.reset(newsorter());
+        extdelentries.reset(newsorter());
+    }
+    now = time(NULL);
+    nextdue = 0;
+    string dbdeleted = fs.database + "/" + fs.deleted;
+    // an up to date index replaces reading the entries, in full scan it is verified
+    WsIndexReader index(fs.database), delindex(dbdeleted);
+    bool indexed = !fullscan && index.isvalid() && delindex.isvalid();
+    auto inspace = [&](const ReconcileAction &a) {
+        return space == "" || a.workspace.find(space) != string::npos;
+    };
+
+    // the directories are always listed, entries the index does not know (e.g. incomplete ones)
+    // are read, so no DB entry is missed for the stray check
+    ReconcileError result = RE_NONE;
+    auto dbentry = [&](const string &name, ReconcileAction &a, int reminder, bool classify) {
+        if (a.workspace == "") {
+            error = "Empty DB entry " + a.path;
+            result = RE_ENTRY;
+            return false;
+        }
+        addkey(name, a.workspace.substr(a.workspace.rfind('/') + 1));
+        if (fullscan && index.isvalid() && !sameentry(index, name, a, reminder)) {
+            indexdiffs.push_back(a.path);
+        }
+        if (expire && inspace(a)) {
+            classifyentry(a, reminder);
+            notedue(a, reminder);
+            if (classify) addentry(entries, extentries.get(), a);
+        }
+        return true;
+    };
+    listdir(fs.database, fs.deleted, [&](const char *name) {
+        WsIndexEntry e;
+        if (indexed && index.find(name, e)) {
+            ReconcileAction a = fromindex(fs.database, e);
+            return dbentry(name, a, e.reminder, false);
+        }
+        ReconcileAction a;
+        int reminder;
+        a.path = fs.database + "/" + name;
+        readentry(a.path, a, reminder);
+        return dbentry(name, a, reminder, true);
+    });
+    if (result != RE_NONE) return result;
+    if (indexed && expire) {
+        // only the entries that are due or need a reminder, read again as the YAML file decides
+        index.due(now + index.getmaxreminder() * 24L * 3600, [&](const WsIndexEntry &e) {
+            ReconcileAction a;
+            int reminder;
+            a.path = fs.database + "/" + e.id;
+            readentry(a.path, a, reminder);
+            // gone since the index was written
+            if (a.workspace == "" || !inspace(a)) return true;
+            classifyentry(a, reminder);
+            if (a.what != RC_KEEP) addentry(entries, extentries.get(), a);
+            return true;
+        });
+    }
+
+    auto delentry = [&](const string &name, ReconcileAction &a, int reminder, bool fromindex) {
+        addremoved(name);
+        if (fullscan && delindex.isvalid() && !sameentry(delindex, name, a, reminder)) {
+            indexdiffs.push_back(a.path);
+        }
+        if (!expire || !inspace(a) || !classifydeleted(name, a)) return true;
+        notedue(a, 0);
+        if (a.what == RC_DELETE && fromindex) {
+            // deleting is for good, the YAML file decides
+            readentry(a.path, a, reminder);
+            if (a.workspace == "" || !classifydeleted(name, a)) return true;
+        }
+        addentry(delentries, extdelentries.get(), a);
+        return true;
+    };
+    listdir(dbdeleted, "", [&](const char *name) {
+        WsIndexEntry e;
+        if (indexed && delindex.find(name, e)) {
+            ReconcileAction a = fromindex(dbdeleted, e);
+            return delentry(name, a, e.reminder, true);
+        }
+        ReconcileAction a;
+        int reminder = 0;
+        a.path = dbdeleted + "/" + name;
+        if (expire || fullscan) readentry(a.path, a, reminder);
+        return delentry(name, a, reminder, false);
+    });
+
+    if (memlimit > 0) {
+        for (auto sorter : { dbkeys.get(), extdbremoved.get(), extentries.get(), extdelentries.get() }) {
+            sorter->seal();
+            if (!sorter->ok()) {
+                error = "could not write temporary file in " + tmpdir;
+                return RE_TMPFILE;
+            }
+        }
+    } else {
+        auto bypath = [](const ReconcileAction &a, const ReconcileAction &b) { return a.path < b.path; };
+        sort(entries.begin(), entries.end(), bypath);
+        sort(delentries.begin(), delentries.end(), bypath);
+    }
+    return RE_NONE;
+}
+
+/*
+ * merge the sorted listing of each space with the sorted DB names,
+ * a name is valid if it is also in the DB stream. A DB stream ending early
+ * would make all later names stray, so the DB streams are read through once
+ * before anything is emitted, and emitting stops at the first read error.
+ */
+bool Reconciler::classifyexternal(function<void(const ReconcileAction &)> emit)
+{
+    for (auto sorter : { dbkeys.get(), extdbremoved.get() }) {
+        unique_ptr<SortedStream> k = sorter->stream();
+        string key;
+        while (k->next(key)) ;
+        if (!k->ok()) return false;
+    }
+
+    ReconcileAction a = ReconcileAction();
+    auto merge = [&](ExternalSorter *names, ExternalSorter *keys, const string prefix,
+                     ReconcileClass valid, ReconcileClass stray) {
+        unique_ptr<SortedStream> n = names->stream();
+        unique_ptr<SortedStream> k = keys->stream();
+        string name, key;
+        bool haskey = k->next(key);
+        while (n->next(name)) {
+            while (haskey && key < name) {
+                haskey = k->next(key);
+            }
+            if (!k->ok()) return false;
+            a.path = prefix + name;
+            a.what = (haskey && key == name) ? valid : stray;
+            emit(a);
+        }
+        return n->ok();
+    };
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!merge(extworkspaces[i].get(), dbkeys.get(), spaces[i] + "/", RC_VALID, RC_STRAY)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (!merge(extremoved[i].get(), extdbremoved.get(), spaces[i] + "/" + fs.deleted + "/",
+                   RC_VALID_REMOVED, RC_STRAY_REMOVED)) {
+            return false;
+        }
+    }
+    if (expire) {
+        for (auto sorter : { extentries.get(), extdelentries.get() }) {
+            unique_ptr<SortedStream> e = sorter->stream();
+            string r;
+            while (e->next(r)) {
+                deserialize(r, a);
+                emit(a);
+            }
+            if (!e->ok()) return false;
+        }
+    }
+    return true;
+}
+
+bool Reconciler::classify(function<void(const ReconcileAction &)> emit)
+{
+    if (memlimit > 0) {
+        return classifyexternal(emit);
+    }
+    ReconcileAction a = ReconcileAction();
+    for (size_t i = 0; i < spaces.size(); i++) {
+        for (auto const &name : workspaces[i]) {
+            a.path = spaces[i] + "/" + name;
+            a.what = (dbworkspaces.count(name) || dbnames.count(name)) ? RC_VALID : RC_STRAY;
+            emit(a);
+        }
+    }
+    for (size_t i = 0; i < spaces.size(); i++) {
+        for (auto const &name : removed[i]) {
+            a.path = spaces[i] + "/" + fs.deleted + "/" + name;
+            a.what = dbremoved.count(name) ? RC_VALID_REMOVED : RC_STRAY_REMOVED;
+            emit(a);
+        }
+    }
+    for (auto const &e : entries) emit(e);
+    for (auto const &e : delentries) emit(e);
+    return true;
+}
@@ -0,0 +1,185 @@
+#ifndef RECONCILE_H
+#define RECONCILE_H
+
+/*
+ *  workspace++
+ *
+ *  reconciliation of the spaces of a filesystem with its DB, for the stray phase of ws_expirer
+ *
+ *  a workspace directory (space/user-name) is valid if its name is the name of a DB entry
+ *  or the last component of the workspace path of a DB entry, otherwise it is stray.
+ *  A directory in space/deleted is valid if a DB entry of that name exists in DB/deleted.
+ *  Names are compared like the globs of ws_expirer: containing a - and not starting with a dot.
+ *
+ *  the spaces are listed before the DB is read, so a workspace created during the run has
+ *  its DB entry already and is never taken for stray (see #87). Listings are read with
+ *  getdents64 and the DB names are kept in hash sets, so the cost is linear in the number
+ *  of entries.
+ *
+ *  with a memory limit (setexternal), all listings go through an ExternalSorter instead,
+ *  which writes sorted runs to temporary files, and classify merges the sorted listings
+ *  of each space with the sorted DB names. Memory stays flat regardless of the number of
+ *  entries, the order of the scan (spaces first, DB second) is the same.
+ *
+ *  with setexpire, the DB entries read for the stray check are classified for expiry as
+ *  well, and the entries in DB/deleted for deletion after keeptime. So ws_expirer needs only
+ *  one pass over the DB, and each entry is read once.
+ *
+ *  if the index of the DB directory and of its deleted directory are up to date (wsindex.h),
+ *  the names and workspaces are taken from the index instead (entries missing in the index
+ *  are read), and only the entries that are due for expiry, reminder or deletion are read,
+ *  the index is ordered by expiration for that. The YAML file of such an entry decides, the
+ *  index only selects. Entries not due are not classified as RC_KEEP then. A full scan (setfullscan) reads all entries as
+ *  without index, and compares the index with them.
+ *
+ *  the time the next entry needs the expirer is collected from all classified entries
+ *  (getnextdue), for the service mode of ws_expirer.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <memory>
+
+#include "wsconfig.h"
+#include "extsort.h"
+
+class WsIndexReader;
+struct WsIndexEntry;
+
+using namespace std;
+
+enum ReconcileClass {
+    RC_VALID,               // workspace with DB entry
+    RC_STRAY,               // workspace without DB entry, to be moved to deleted
+    RC_VALID_REMOVED,       // deleted workspace with DB entry in DB/deleted
+    RC_STRAY_REMOVED,       // deleted workspace without DB entry, to be deleted
+    // only with setexpire, for DB entries
+    RC_KEEP,                // DB entry not expired
+    RC_REMIND,              // DB entry not expired, but reminder is due
+    RC_EXPIRE,              // DB entry expired, to be moved to DB/deleted with its workspace
+    RC_RESTORABLE,          // DB entry in DB/deleted within keeptime
+    RC_DELETE,              // DB entry in DB/deleted over keeptime or released, to be deleted with its workspace
+    RC_BROKEN               // DB entry without expiration or with bad timestamp, skipped
+};
+
+struct ReconcileAction {
+    ReconcileClass what;
+    string path;            // full path of the directory, or of the DB entry
+    // for DB entries
+    string workspace;       // workspace, in the deleted directory of its space for RC_RESTORABLE and RC_DELETE
+    long expiration;        // time of release or expiry for RC_RESTORABLE and RC_DELETE
+    long released;          // 0 if not released by the user
+    string mailaddress;
+};
+
+// why a scan could not be done
+enum ReconcileError {
+    RE_NONE,
+    RE_MAGIC,               // DB has no or a wrong .ws_db_magic, maybe not mounted
+    RE_ENTRY,               // DB entry without workspace, DB needs manual intervention
+    RE_TMPFILE              // temporary file for external sort could not be written
+};
+
+
+class Reconciler {
+
+private:
+    const FilesystemConfig &fs;
+    int dbuid, dbgid;
+    vector<string> spaces;
+    // snapshot of the spaces, taken before the DB
+    vector<vector<string> > workspaces, removed;
+    unordered_set<string> dbnames, dbworkspaces, dbremoved;
+    // same for external mode, dbkeys has names and workspaces of DB entries
+    size_t memlimit;
+    string tmpdir;
+    vector<unique_ptr<ExternalSorter> > extworkspaces, extremoved;
+    unique_ptr<ExternalSorter> dbkeys, extdbremoved;
+    // classified DB entries and entries in DB/deleted, only with setexpire
+    bool expire, fullscan, dbonly;
+    long now, nextdue;
+    vector<ReconcileAction> entries, delentries;
+    unique_ptr<ExternalSorter> extentries, extdelentries;
+    // DB entries that differ from the index, only in full scan
+    vector<string> indexdiffs;
+
+    ExternalSorter *newsorter();
+    bool sortdir(const string dir, const string skip, ExternalSorter *sorter);
+    void addentry(vector<ReconcileAction> &v, ExternalSorter *sorter, const ReconcileAction &a);
+    void addkey(const string &name, const string &wsname);
+    void addremoved(const string &name);
+    void classifyentry(ReconcileAction &a, int reminder);
+    bool classifydeleted(const string &name, ReconcileAction &a);
+    void notedue(const ReconcileAction &a, int reminder);
+    static ReconcileAction fromindex(const string &dir, const WsIndexEntry &e);
+    static bool sameentry(const WsIndexReader &index, const string &name, const ReconcileAction &a, int reminder);
+    bool classifyexternal(function<void(const ReconcileAction &)> emit);
+
+public:
+    Reconciler(const FilesystemConfig &fs, const int dbuid, const int dbgid);
+
+    // sort with bounded memory, memlimit bytes per listing in memory, 0 is in memory with hash sets
+    void setexternal(size_t memlimit, const string tmpdir);
+
+    // also classify DB entries for expiry and deletion (single pass of ws_expirer)
+    void setexpire(bool expire);
+
+    // read all DB entries even if the index is up to date, and compare the index with them
+    void setfullscan(bool fullscan);
+
+    // do not list the spaces, only the DB is read, for getnextdue
+    void setdbonly(bool dbonly);
+
+    // time an entry that is not due now needs a reminder, expiry or deletion,
+    // 0 if there is none, after a scan with setexpire
+    long getnextdue() {
+        return nextdue;
+    }
+
+    // DB entries that differ from the index or are missing in it, after a full scan
+    const vector<string> &getindexdiffs() {
+        return indexdiffs;
+    }
+
+    // list spaces (all or only space) first and DB second, error describes the problem if not RE_NONE
+    // with only space, DB entries of workspaces in other spaces are not classified
+    ReconcileError scan(const string space, string &error);
+
+    // classify everything scanned, spaces in config order, names sorted,
+    // then DB entries and entries in DB/deleted, sorted, false if a temporary file
+    // could not be read, nothing is emitted then if the DB names could not be read
+    bool classify(function<void(const ReconcileAction &)> emit);
+
+    // read workspace, expiration, reminder, mailaddress and released from a DB entry,
+    // YAML or the old format of the python version
+    static void readentry(const string filename, ReconcileAction &a, int &reminder);
+
+    // names of a directory that look like workspaces or DB entries, skipping skip
+    static vector<string> listdir(const string dir, const string skip);
+    // same without keeping names, unsorted, stops when found returns false
+    static void listdir(const string dir, const string skip, function<bool(const char *)> found);
+
+    static const char *classname(ReconcileClass what);
+};
+
+#endif
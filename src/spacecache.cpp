@@ -0,0 +1,175 @@
+/*
+ *  workspace++
+ *
+ *  free space of the spaces of a workspace filesystem
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef SETUID
+#include <sys/capability.h>
+#include "fscred.h"
+#endif
+
+#include "spacecache.h"
+#include "pathprobe.h"
+#include "trustedfile.h"
+
+using namespace std;
+
+static string cachedir;
+static int maxage = 60;
+static uid_t trusteduid = 0;
+
+
+static bool trusted(const struct stat &st)
+{
+    return (st.st_uid == 0 || st.st_uid == trusteduid) && !(st.st_mode & (S_IWGRP|S_IWOTH));
+}
+
+void SpaceCache::setup(const string _cachedir, const int _maxage, const uid_t _trusteduid)
+{
+    cachedir = _cachedir;
+    maxage = _maxage;
+    trusteduid = _trusteduid;
+
+    struct stat st;
+    if (cachedir != "" && (stat(cachedir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || !trusted(st))) {
+        cachedir = "";
+    }
+}
+
+
+/*
+ * read samples, false if missing, untrusted, too old or not matching the configured spaces
+ */
+bool SpaceCache::readfile(const string filename, const vector<string> &spaces, const int maxage,
+                          vector<SpaceSample> &samples)
+{
+    int fd = open(filename.c_str(), O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || !trusted(st) || st.st_size > 1024*1024) {
+        close(fd);
+        return false;
+    }
+    string content(st.st_size, '\0');
+    bool ok = read(fd, &content[0], st.st_size) == st.st_size;
+    close(fd);
+    if (!ok) return false;
+
+    istringstream in(content);
+    string line;
+    if (!getline(in, line) || line != "wsspace 2") return false;
+    if (!getline(in, line)) return false;
+    time_t stamp = atol(line.c_str());
+    time_t now = time(NULL);
+    if (stamp > now || now - stamp >= maxage) return false;
+
+    samples.clear();
+    while (getline(in, line)) {
+        istringstream fields(line);
+        SpaceSample s;
+        if (!(fields >> s.freebytes >> s.totalbytes >> s.freeinodes >> s.totalinodes >> s.error)) return false;
+        fields.get();
+        getline(fields, s.space);
+        s.seconds = 0;
+        samples.push_back(s);
+    }
+    if (samples.size() != spaces.size()) return false;
+    for (size_t i = 0; i < spaces.size(); i++) {
+        if (samples[i].space != spaces[i]) return false;
+    }
+    return true;
+}
+
+/*
+ * write samples atomically, errors are ignored
+ */
+void SpaceCache::writefile(const string filename, const vector<SpaceSample> &samples)
+{
+    uid_t euid = geteuid();
+    bool asuser = euid != 0 && euid != trusteduid;
+#ifdef SETUID
+    if (asuser) return;
+#endif
+
+    ostringstream out;
+    out << "wsspace 2\n" << time(NULL) << "\n";
+    for (auto const &s : samples) {
+        out << s.freebytes << " " << s.totalbytes << " " << s.freeinodes << " " << s.totalinodes << " "
+            << s.error << " " << s.space << "\n";
+    }
+    string content = out.str();
+
+    size_t slash = filename.rfind('/');
+    if (slash == string::npos) return;
+#ifndef SETUID
+    // the capability build runs as the user, the file is given to the DB user (see nsscache)
+    CapScope caps(asuser ? initializer_list<int>{CAP_DAC_OVERRIDE, CAP_CHOWN} : initializer_list<int>{},
+                  __LINE__, __FILE__);
+#endif
+    int dirfd = open(filename.substr(0, slash).c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dirfd < 0) return;
+    writetrusted(dirfd, filename.substr(slash + 1), content, asuser ? trusteduid : (uid_t)-1, (gid_t)-1);
+    close(dirfd);
+}
+
+
+vector<SpaceSample> SpaceCache::getfree(const string fsname, const vector<string> &spaces,
+                                        const double timeout, bool &cached)
+{
+    vector<SpaceSample> samples;
+    string filename;
+    if (cachedir != "" && fsname.find('/') == string::npos && fsname[0] != '.') {
+        filename = cachedir + "/space-" + fsname;
+    }
+    cached = filename != "" && readfile(filename, spaces, maxage, samples);
+    if (cached) return samples;
+
+    samples.clear();
+    PathProbe probe(spaces, PROBE_STATFS);
+    for (size_t i = 0; i < spaces.size(); i++) {
+        ProbeResult r = probe.wait(i, timeout);
+        SpaceSample s;
+        s.space = spaces[i];
+        s.freebytes = r.freebytes;
+        s.totalbytes = r.totalbytes;
+        s.freeinodes = r.freeinodes;
+        s.totalinodes = r.totalinodes;
+        s.error = r.done ? r.error : ETIMEDOUT;
+        s.seconds = r.seconds;
+        samples.push_back(s);
+    }
+    if (filename != "") writefile(filename, samples);
+    return samples;
+}
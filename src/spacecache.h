@@ -0,0 +1,73 @@
+#ifndef SPACECACHE_H
+#define SPACECACHE_H
+
+/*
+ *  workspace++
+ *
+ *  free space of the spaces of a workspace filesystem, for spaceselection mostspace
+ *
+ *  all spaces are sampled at once with statfs() in child processes (see pathprobe.h), spaces
+ *  failing or not answering within the timeout are marked unusable. If a cache directory
+ *  is configured (spacecache), the samples of a filesystem are stored there and reused by
+ *  all allocations within spacecache_maxage seconds. Same trust rules as for nsscache,
+ *  files and directory have to be owned by root or the DB user and not be writable by others,
+ *  and the capability build writes them the same way (trustedfile.h).
+ *
+ *  file format (text), one line per space, in order of the config:
+ *    wsspace 2
+ *    <time of sample>
+ *    <free bytes> <total bytes> <free inodes> <total inodes> <errno> <space>
+ *                                       errno 0 if usable
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+using namespace std;
+
+struct SpaceSample {
+    string space;
+    uint64_t freebytes, totalbytes;
+    uint64_t freeinodes, totalinodes;     // 0 if filesystem has no inode limit
+    int error;          // 0 if usable, ETIMEDOUT if statfs did not answer
+    double seconds;     // time of statfs, 0 if from cache
+};
+
+
+class SpaceCache {
+
+private:
+    static bool readfile(const string filename, const vector<string> &spaces, const int maxage,
+                         vector<SpaceSample> &samples);
+    static void writefile(const string filename, const vector<SpaceSample> &samples);
+
+public:
+    // cachedir empty disables the cache, trusteduid is the DB user
+    static void setup(const string cachedir, const int maxage, const uid_t trusteduid);
+
+    // free space of all spaces of filesystem fsname, cached is set if the samples were reused
+    static vector<SpaceSample> getfree(const string fsname, const vector<string> &spaces,
+                                       const double timeout, bool &cached);
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ *  workspace++
+ *
+ *  files for root and the DB user, written by the tools on behalf of a user
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+
+#include <errno.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/fsuid.h>
+
+#include "trustedfile.h"
+
+using namespace std;
+
+
+bool writetrusted(const int dirfd, const string name, const string &content, const uid_t uid, const gid_t gid)
+{
+    string tmpname = "." + name + ".tmp." + to_string(getpid());
+    bool named = false;
+    int fd = openat(dirfd, ".", O_WRONLY|O_TMPFILE|O_CLOEXEC, 0600);
+    if (fd < 0) {
+        if (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL) return false;
+        // a named file belongs to the fsuid of the thread until the chown, only root
+        // or uid itself may own it that long (setfsuid(-1) changes nothing, returns it)
+        uid_t fsuid = setfsuid(-1);
+        if (uid != (uid_t)-1 && fsuid != 0 && fsuid != uid) return false;
+        unlinkat(dirfd, tmpname.c_str(), 0);
+        fd = openat(dirfd, tmpname.c_str(), O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+        named = true;
+    }
+
+    // mode first, after the chown the thread is not the owner anymore,
+    // and the umask could have removed bits
+    bool ok = fchmod(fd, 0644) == 0;
+    if (ok && (uid != (uid_t)-1 || gid != (gid_t)-1)) ok = fchown(fd, uid, gid) == 0;
+    ok = ok && write(fd, content.data(), content.size()) == (ssize_t)content.size();
+    if (ok && !named) {
+        // linkat with AT_EMPTY_PATH would need CAP_DAC_READ_SEARCH, the link in /proc does not
+        string procname = "/proc/self/fd/" + to_string(fd);
+        unlinkat(dirfd, tmpname.c_str(), 0);
+        ok = linkat(AT_FDCWD, procname.c_str(), dirfd, tmpname.c_str(), AT_SYMLINK_FOLLOW) == 0;
+        named = ok;
+    }
+    if (close(fd) != 0) ok = false;
+    ok = ok && renameat(dirfd, tmpname.c_str(), dirfd, name.c_str()) == 0;
+    if (!ok && named) unlinkat(dirfd, tmpname.c_str(), 0);
+    return ok;
+}
@@ -0,0 +1,48 @@
+#ifndef TRUSTEDFILE_H
+#define TRUSTEDFILE_H
+
+/*
+ *  workspace++
+ *
+ *  files for root and the DB user, written by the tools on behalf of a user
+ *
+ *  Caches and deletion tickets are trusted by their owner. The capability build acts as the
+ *  calling user and gives such a file away with CAP_CHOWN, so a file created under a name
+ *  belongs to the user until then, and the user could open it for writing in that moment
+ *  and keep the descriptor after the chown. writetrusted creates the file without a name
+ *  (O_TMPFILE), sets mode and owner before anything is written, and only then links it into
+ *  the directory and renames it over the old file, so only a file of its final owner is
+ *  ever visible.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <sys/types.h>
+
+using namespace std;
+
+// write content to name in directory dirfd as a file of uid:gid with mode 0644, replacing name
+// atomically, false on errors. -1 keeps the id of the thread, for callers acting as root or DB
+// user already. Needs write permission on the directory, and CAP_CHOWN to give the file away.
+// Without O_TMPFILE (old kernels, some network file systems) a named temporary file is used,
+// but only if the thread acts as root or uid, otherwise nothing is written.
+bool writetrusted(const int dirfd, const string name, const string &content, const uid_t uid, const gid_t gid);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+/*
+ *  workspace++
+ *
+ *  small work stealing thread pool, used by the tree walkers (deletion, copy)
+ *
+ *  every worker owns a deque, it pushes and pops new work at the back (depth first,
+ *  keeps the number of open directories low), idle workers steal from the front of
+ *  the other deques (oldest items, usually the biggest subtrees).
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+
+template <class T>
+class WorkPool {
+
+public:
+    // handler is called with the work item and the number of the calling worker
+    typedef std::function<void(T, int)> Handler;
+
+    WorkPool(int _nthreads, Handler _handler)
+        : nthreads(_nthreads < 1 ? 1 : _nthreads), handler(_handler), pending(0), stopflag(false), next(0)
+    {
+        for (int i=0; i<nthreads; i++) {
+            queues.push_back(std::unique_ptr<Queue>(new Queue));
+        }
+    }
+
+    // add work, worker is the number of the calling worker or -1 if called from outside
+    void push(T item, int worker=-1) {
+        if (worker<0 || worker>=nthreads) {
+            worker = next++ % nthreads;
+        }
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(queues[worker]->m);
+            queues[worker]->q.push_back(item);
+        }
+        idlecv.notify_one();
+    }
+
+    // run until all work is done or stop() was called, the calling thread is worker 0
+    void run() {
+        std::vector<std::thread> threads;
+        for (int i=1; i<nthreads; i++) {
+            threads.push_back(std::thread(&WorkPool::work, this, i));
+        }
+        work(0);
+        for (auto &t: threads) {
+            t.join();
+        }
+    }
+
+    // stop handing out work, items still queued can be fetched with leftover()
+    void stop() {
+        stopflag = true;
+        idlecv.notify_all();
+    }
+
+    bool stopped() {
+        return stopflag;
+    }
+
+    // items not processed, only meaningful after run() returned
+    std::vector<T> leftover() {
+        std::vector<T> items;
+        for (auto &q: queues) {
+            std::lock_guard<std::mutex> lock(q->m);
+            items.insert(items.end(), q->q.begin(), q->q.end());
+            q->q.clear();
+        }
+        return items;
+    }
+
+    int size() {
+        return nthreads;
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<T> q;
+    };
+
+    int nthreads;
+    Handler handler;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<long> pending;
+    std::atomic<bool> stopflag;
+    std::atomic<unsigned> next;
+    std::mutex idlem;
+    std::condition_variable idlecv;
+
+    // own queue from the back, otherwise steal from the front of the others
+    bool pop(int worker, T &item) {
+        {
+            std::lock_guard<std::mutex> lock(queues[worker]->m);
+            if (!queues[worker]->q.empty()) {
+                item = queues[worker]->q.back();
+                queues[worker]->q.pop_back();
+                return true;
+            }
+        }
+        for (int i=1; i<nthreads; i++) {
+            Queue &victim = *queues[(worker+i) % nthreads];
+            std::lock_guard<std::mutex> lock(victim.m);
+            if (!victim.q.empty()) {
+                item = victim.q.front();
+                victim.q.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(int worker) {
+        while (!stopflag) {
+            T item;
+            if (pop(worker, item)) {
+                handler(item, worker);
+                if (--pending == 0) {
+                    idlecv.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(idlem);
+            if (pending == 0) break;
+            // items can be pushed without holding idlem, so do not sleep forever
+            idlecv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+};
+
+#endif
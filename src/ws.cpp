@@ -35,6 +35,7 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <set>
 #include <unistd.h>
 #include <grp.h>
 #include <sys/types.h>
@@ -42,8 +43,12 @@
 #include <sys/vfs.h>
 #include <time.h>
 #include <pwd.h>
-#include <sys/wait.h>
 #include <syslog.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/syscall.h>
 
 
 
@@ -67,7 +72,17 @@
 #endif
 
 #include "ws.h"
+#include "wsconfig.h"
+#include "nsscache.h"
+#include "pathprobe.h"
+#include "spacecache.h"
+#include "placement.h"
+#include "pathstats.h"
 #include "wsdb.h"
+#include "deltree.h"
+#include "delspool.h"
+#include "movetree.h"
+#include "fscred.h"
 
 namespace fs = boost::filesystem;
 namespace po = boost::program_options;
@@ -75,6 +90,107 @@ using boost::lexical_cast;
 
 using namespace std;
 
+// older C libraries do not have it, the kernel might still
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+
+/*
+ * create path and missing parents, returns 0 or errno and path opened in fd. Usually only
+ * the last directory is missing, then the parent is the only lookup of a whole path and the
+ * rest is relative to it. Missing parents get mode 0700 without relying on the umask of
+ * the process, path itself is left to the caller, which changes owner and mode through fd.
+ */
+static int makepath(const string path, int &fd)
+{
+    size_t slash = path.find_last_of('/');
+    string parent = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    string name = slash == string::npos ? path : path.substr(slash + 1);
+    if (name == "" || name == ".") return makepath(parent, fd);
+
+    PathStats::paths()++;
+    int dirfd = open(parent.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dirfd < 0) {
+        if (errno != ENOENT) return errno;
+        int err = makepath(parent, dirfd);
+        if (err) return err;
+        // the umask could have removed bits
+        fchmod(dirfd, 0700);
+    }
+    PathStats::names()++;
+    if (mkdirat(dirfd, name.c_str(), 0700) != 0 && errno != EEXIST) {
+        int err = errno;
+        close(dirfd);
+        return err;
+    }
+    // the new directory and not what a symlink put there points to
+    PathStats::names()++;
+    fd = openat(dirfd, name.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+    int err = errno;
+    close(dirfd);
+    return fd < 0 ? err : 0;
+}
+
+
+/*
+ * claim a precreated directory from the pool of space (see ws_expirer) as path, with one rename,
+ * returns false if the pool is empty or missing, or if path exists or is not in space.
+ * The pool has slots named 0 to slots-1, ws_expirer renames a directory into a slot once it is
+ * owned by the DB user and has mode 000, the caller changes owner and mode of fd. Slot pid % slots
+ * is tried first, then its neighbours, so concurrent allocations rarely meet and nothing is listed:
+ * open of the parent, the rename and the open of the claimed directory, as many lookups as makepath.
+ */
+static bool claimpool(const string space, const string path, const uid_t dbuid, const int slots, int &fd)
+{
+#ifdef SYS_renameat2
+    size_t slash = path.find_last_of('/');
+    if (slots <= 0 || slash == string::npos || slash < space.size()) return false;
+    string parent = path.substr(0, slash);
+    string name = path.substr(slash + 1);
+
+    PathStats::paths()++;
+    int parentfd = open(parent.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (parentfd < 0) return false;
+    // the pool is next to the workspaces, unless a prefix put them in a subdirectory
+    string pool = string(WSPOOL_NAME) + "/";
+    int poolfd = parentfd;
+    if (parent != space) {
+        pool = space + "/" + WSPOOL_NAME + "/";
+        poolfd = AT_FDCWD;
+    }
+
+    bool claimed = false;
+    int start = getpid() % slots;
+    // an empty pool costs a failed rename per slot tried before makepath
+    for (int i = 0; i < slots && i < 4 && !claimed; i++) {
+        string slot = pool + to_string((start + i) % slots);
+        if (poolfd == AT_FDCWD) PathStats::paths()++; else PathStats::names()++;
+        PathStats::names()++;
+        if (syscall(SYS_renameat2, poolfd, slot.c_str(), parentfd, name.c_str(), RENAME_NOREPLACE) != 0) {
+            // slot is empty or taken by another allocation, try the next one,
+            // path exists, or no renameat2 here, makepath has to do it
+            if (errno != ENOENT) break;
+            continue;
+        }
+        PathStats::names()++;
+        fd = openat(parentfd, name.c_str(), O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && st.st_uid == dbuid && (st.st_mode & 07777) == 0) {
+            claimed = true;
+        } else {
+            // not made by ws_expirer, do not hand it out
+            if (fd >= 0) close(fd);
+            if (unlinkat(parentfd, name.c_str(), AT_REMOVEDIR) != 0) unlinkat(parentfd, name.c_str(), 0);
+        }
+    }
+    close(parentfd);
+    return claimed;
+#else
+    return false;
+#endif
+}
+
 
 /*
  * read global and user config and validate parameters
@@ -84,19 +200,21 @@ Workspace::Workspace(const whichclient clientcode, const po::variables_map _opt,
     : opt(_opt), duration(_duration), filesystem(_filesystem)
 {
 
-    // set a umask so users can access db files
-    umask(0002);
-
     // read config
+    YAML::Node yamlconfig, yamluserconfig;
     try {
-        config = YAML::LoadFile("/etc/ws.conf");
+        yamlconfig = WsConfig::load("/etc/ws.conf");
     } catch (const YAML::BadFile& e) {
         cerr << "Error: Could not read config file!" << endl;
         cerr << e.what() << endl;
         exit(-1);
     }
-    db_uid = config["dbuid"].as<int>();
-    db_gid = config["dbgid"].as<int>();
+    if (!yamlconfig["dbuid"] || !yamlconfig["dbgid"]) {
+        cerr << "Error: no dbuid or dbgid in config!" << endl;
+        exit(-1);
+    }
+    db_uid = yamlconfig["dbuid"].as<int>();
+    db_gid = yamlconfig["dbgid"].as<int>();
 
     /*  seems redundant 
     // lower capabilities to minimum
@@ -108,20 +226,26 @@ Workspace::Workspace(const whichclient clientcode, const po::variables_map _opt,
     	drop_cap(CAP_DAC_OVERRIDE, CAP_DAC_READ_SEARCH, db_uid);
     */
 
-    // read private config
-    raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
-    try {
-        userconfig = YAML::LoadFile("/etc/ws_private.conf");
-    } catch (const YAML::BadFile&) {
-        // we do not care
+    // read private config, lowered again at the end of the scope
+    {
+        CapScope caps({CAP_DAC_OVERRIDE}, __LINE__, __FILE__);
+        try {
+            yamluserconfig = WsConfig::load("/etc/ws_private.conf");
+        } catch (const YAML::BadFile&) {
+            // we do not care
+        }
     }
-    // lower again, nothing needed
-    lower_cap(CAP_DAC_OVERRIDE, db_uid);
+
+    // parse once, everything below uses the typed config
+    config = GlobalConfig(yamlconfig, yamluserconfig);
+    // ws_restore has no CAP_CHOWN, cache files are only read there in the capability build
+    NssCache::setup(config.nsscache, config.nsscache_ttl, db_uid, clientcode != WS_Restore);
+    SpaceCache::setup(config.spacecache, config.spacecache_maxage, db_uid);
 
     username = getusername(); // FIXME is this correct? what if username given on commandline?
 
     // valide the input  (opt contains name, duration and filesystem as well)
-    validate(clientcode, config, userconfig, opt, filesystem, duration, maxextensions, acctcode);
+    validate(clientcode, opt, filesystem, duration, maxextensions, acctcode);
 }
 
 /*
@@ -135,8 +259,8 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
     // see if we have a prefix callout
     string prefixcallout;
     lua_State* L;
-    if(config["workspaces"][filesystem]["prefix_callout"]) {
-        prefixcallout = config["workspaces"][filesystem]["prefix_callout"].as<string>();
+    if(config.getfs(filesystem).prefix_callout != "") {
+        prefixcallout = config.getfs(filesystem).prefix_callout;
         // L = lua_open();  // LUA 5.1
 	L = luaL_newstate(); // LUA 5.3
         luaL_openlibs(L);
@@ -174,47 +298,59 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 		}
     }
 
-	// loop over valid workspaces
+    // construct db-entry names, special case if called by root with -x and -u, allows overwrite of maxextensions
+    vector<string> dbfilenames;
     for(string cfilesystem: searchlist) {
-      // construct db-entry name, special case if called by root with -x and -u, allows overwrite of maxextensions
+      if(user_option.length()>0 && (extensionflag || getuid()==0)) {
+          dbfilenames.push_back(config.getfs(cfilesystem).database + "/"+user_option+"-"+name);
+      } else {
+          dbfilenames.push_back(config.getfs(cfilesystem).database + "/"+username+"-"+name);
+      }
+    }
+
+    // check all DBs at once, a hanging DB filesystem must not block us
+    PathProbe probe(dbfilenames);
+    set<string> timedout;
+
+	// loop over valid workspaces
+    for(size_t i=0; i<searchlist.size(); i++) {
+      string cfilesystem = searchlist[i];
+      dbfilename = dbfilenames[i];
       if (opt.count("debug")) {
 		  cerr << "debug: searching valid filesystems " << cfilesystem << endl;
+		  cerr << "debug: check existance of db entry <" << dbfilename << ">" << endl;
 	  }
 
-      if(extensionflag && user_option.length()>0) {
-          dbfilename=config["workspaces"][cfilesystem]["database"].as<string>() + "/"+user_option+"-"+name;
-          if(!fs::exists(dbfilename)) {
-              cerr << "Error: workspace does not exist, can not be extended!" << endl;
-              exit(-1);
-			  // FIXME looks wrong? exit in loops?
-          }
-      } else { 
-          if(user_option.length()>0 && (getuid()==0)) {
-              dbfilename=config["workspaces"][cfilesystem]["database"].as<string>() + "/"+user_option+"-"+name;
-          } else { 
-              dbfilename=config["workspaces"][cfilesystem]["database"].as<string>() + "/"+username+"-"+name;
-          }
-      }
-
       // does db entry exist?
+      ProbeResult probed = probe.wait(i, config.getfs(cfilesystem).dbprobe_timeout);
       if (opt.count("debug")) {
-		  cerr << "debug: check existance of db entry <" << dbfilename << ">" << endl;
-	  }
+          cerr << "debug: DB check of " << cfilesystem << " took " << probed.seconds << " seconds" << endl;
+      }
+      syslog(LOG_DEBUG, "DB check of <%s> for user <%s> took %.3f seconds%s.", cfilesystem.c_str(),
+             username.c_str(), probed.seconds, probed.done ? "" : " and timed out");
+      if (!probed.done) {
+          cerr << "Warning: DB of filesystem " << cfilesystem << " does not answer, skipping it." << endl;
+          syslog(LOG_INFO, "DB check of <%s> timed out after %.1f seconds, skipped.", cfilesystem.c_str(), probed.seconds);
+          timedout.insert(cfilesystem);
+          continue;
+      }
+
+      if(extensionflag && user_option.length()>0 && !probed.exists) {
+          cerr << "Error: workspace does not exist, can not be extended!" << endl;
+          exit(-1);
+          // FIXME looks wrong? exit in loops?
+      }
 
-	  // extra error checking, this could acess a path that does not exist and could give unexpected errors/throw
-	  boost::system::error_code ec;
-      if(fs::exists(dbfilename, ec)) {
-          WsDB dbentry(dbfilename,  config["dbuid"].as<int>(),  config["dbgid"].as<int>());
+      if(probed.exists) {
+          WsDB dbentry(dbfilename, db_uid, db_gid);
           wsdir = dbentry.getwsdir();
           extension = dbentry.getextension();
           expiration = dbentry.getexpiration();
           // if it exists, print it, if extension is required, extend it
           if(extensionflag) {
-              if ( config["workspaces"][cfilesystem]["extendable"] ) {
-                  if ( config["workspaces"][cfilesystem]["extendable"].as<bool>() == false ) {
-                      cerr << "Error: workspaces can not be extended in this filesystem." << endl;
-                      exit(1);
-                  }
+              if ( !config.getfs(cfilesystem).extendable ) {
+                  cerr << "Error: workspaces can not be extended in this filesystem." << endl;
+                  exit(1);
               }
               // we allow a user to specify -u -x together, and to extend a workspace if he has rights on the workspace
               if(user_option.length()>0 && (user_option != username) && (getuid() != 0)) {
@@ -250,16 +386,7 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 				// new code for duration check for existing workspaces
 				// check durations - userexception in workspace/workspace/global
 
-				int configduration;
-				if(userconfig["workspaces"][cfilesystem]["userexceptions"][username]["duration"]) {
-					configduration = userconfig["workspaces"][cfilesystem]["userexceptions"][username]["duration"].as<int>();
-				} else {
-					if(config["workspaces"][cfilesystem]["duration"]) {
-						configduration = config["workspaces"][cfilesystem]["duration"].as<int>();
-					} else {
-						configduration = config["duration"].as<int>();
-					}
-				}
+				int configduration = config.getfs(cfilesystem).getduration(username);
 				if ( getuid()!=0 && ( (duration > configduration) || (duration < 0)) ) {
 					duration = configduration;
 					cerr << "Error: Duration longer than allowed for this workspace" << endl;
@@ -280,23 +407,28 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
           break;
       } else {
       	if (opt.count("debug")) {
-		  cerr << "error: existence check: " << ec << " for " << dbfilename << endl;
+		  cerr << "error: existence check: " << strerror(probed.error ? probed.error : ENOENT) << " for " << dbfilename << endl;
 		}
 	  }
     } // loop over searchlist
 
     if (!ws_exists) {
+        if (timedout.count(filesystem)) {
+            cerr << "Error: DB of filesystem " << filesystem << " does not answer, can not allocate there." << endl;
+            exit(-1);
+        }
+
         if(extensionflag && user_option.length()>0) {
-            dbfilename=config["workspaces"][filesystem]["database"].as<string>() + "/"+user_option+"-"+name;
+            dbfilename=config.getfs(filesystem).database + "/"+user_option+"-"+name;
             if(!fs::exists(dbfilename)) {
                 cerr << "Error: workspace does not exist, can not be extended!" << endl;
                 exit(-1);
             }
         } else {
             if(user_option.length()>0 && (getuid()==0)) {
-                dbfilename=config["workspaces"][filesystem]["database"].as<string>() + "/"+user_option+"-"+name;
+                dbfilename=config.getfs(filesystem).database + "/"+user_option+"-"+name;
             } else {
-                dbfilename=config["workspaces"][filesystem]["database"].as<string>() + "/"+username+"-"+name;
+                dbfilename=config.getfs(filesystem).database + "/"+username+"-"+name;
                 if(extensionflag) {
                       if(!fs::exists(dbfilename)) {
                           cerr << "Error: workspace does not exist, can not be extended!" << endl;
@@ -308,15 +440,19 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 
 
         // workspace does not exist, we have to create one
-        if( config["workspaces"][filesystem]["allocatable"] &&
-            config["workspaces"][filesystem]["allocatable"].as<bool>() == false )  {
+        const FilesystemConfig &fsconfig = config.getfs(filesystem);
+        if( !fsconfig.allocatable )  {
             cerr << "Error: this workspace can not be used for allocation." << endl;
             exit(1);
         }
         // if it does not exist, create it
         cerr << "Info: creating workspace." << endl;
         // read the possible spaces for the filesystem
-        vector<string> spaces = config["workspaces"][filesystem]["spaces"].as<vector<string> >();
+        const vector<string> &spaces = fsconfig.spaces;
+        if (spaces.empty()) {
+            cerr << "Error: no spaces configured for this workspace." << endl;
+            exit(1);
+        }
         string prefix = "";
 
         // the lua function "prefix" gets called as prefix(filesystem, username)
@@ -334,26 +470,7 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
         }
 #endif
 
-        // add some randomness
-        srand(time(NULL));
-		int spaceid=rand()%spaces.size();  // default is random
-		if(config["workspaces"][filesystem]["spaceselection"]) {
-			if(config["workspaces"][filesystem]["spaceselection"].as<string>() == "uid") spaceid = getuid() % spaces.size();
-			if(config["workspaces"][filesystem]["spaceselection"].as<string>() == "gid") spaceid = getgid() % spaces.size();
-			if(config["workspaces"][filesystem]["spaceselection"].as<string>() == "mostspace") {
-				spaceid = 0;
-				fsblkcnt_t max_free_bytes = 0;
-				for (size_t i = 0; i < spaces.size(); ++i) {
-					struct statfs sfs;
-					statfs(spaces[i].c_str(), &sfs);
-					fsblkcnt_t free_bytes = sfs.f_bsize * sfs.f_bfree;
-					if (free_bytes > max_free_bytes) {
-						max_free_bytes = free_bytes;
-						spaceid = i;
-					}
-				}
-			}
-		}
+        int spaceid = Placement::choose(fsconfig, getuid(), getgid(), opt.count("debug"));
 		if (opt.count("debug")) {
 			cerr << "Info: spaceid=" << spaceid << endl;
 		}
@@ -370,24 +487,6 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
             }
         }
 
-        // make directory and change owner + permissions
-        try {
-            raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
-            mode_t oldmask = umask( 077 );    // as we create intermediate directories, we better take care of umask!!
-            fs::create_directories(wsdir);
-            umask(oldmask);
-            lower_cap(CAP_DAC_OVERRIDE, db_uid);
-        } catch (...) {
-            auto uid=getuid();
-	    auto euid=geteuid();
-            lower_cap(CAP_DAC_OVERRIDE, db_uid);
-            cerr << "Error: could not create workspace directory <" << wsdir << ">! "  << endl;
-	    if (opt.count("debug")) {
-		    cerr << "Debug: uid: " << uid << " euid: " << euid <<endl;
-	    }
-            exit(-1);
-        }
-
         uid_t tuid=getuid();
         gid_t tgid=getgid();
 
@@ -405,23 +504,6 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 			}
 		}
 
-        raise_cap(CAP_CHOWN, __LINE__, __FILE__);
-        /*
-        // removed 3.6.2020, what was it good for??
-        if(prefix.length()>0) {  // in case we have a prefix, we change owner of that one
-            chown(wsdir_nopostfix.c_str(), tuid, tgid);
-        }
-        */
-
-        if(chown(wsdir.c_str(), tuid, tgid)) {
-            lower_cap(CAP_CHOWN, db_uid);
-            cerr << "Error: could not change owner of workspace!" << endl;
-            unlink(wsdir.c_str());
-            exit(-1);
-        }
-        lower_cap(CAP_CHOWN, db_uid);
-
-        raise_cap(CAP_FOWNER, __LINE__, __FILE__);
 		mode_t mode = S_IRUSR | S_IWUSR | S_IXUSR;
         // group workspaces can be read and listed by group
 		if (opt.count("group") || groupname!="") {
@@ -430,22 +512,55 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 		if (groupname!="") {
 			mode |= S_IWGRP | S_ISGID;
 		}
-        if(chmod(wsdir.c_str(), mode)) {
-            lower_cap(CAP_FOWNER, db_uid);
-            cerr << "Error: could not change permissions of workspace!" << endl;
-            unlink(wsdir.c_str());
-            exit(-1);
+
+        // make directory and change owner + permissions, one transition for all three
+        {
+            CapScope caps({CAP_DAC_OVERRIDE, CAP_CHOWN, CAP_FOWNER}, __LINE__, __FILE__);
+            int wsfd;
+            int err = 0;
+            bool pooled = fsconfig.pool_size > 0 && claimpool(spaces[spaceid], wsdir, db_uid, fsconfig.pool_size, wsfd);
+            if (!pooled) {
+                err = makepath(wsdir, wsfd);
+            }
+            if (opt.count("debug")) {
+                cerr << "Debug: workspace directory " << (pooled ? "taken from pool" : "created") << endl;
+            }
+            if (err) {
+                cerr << "Error: could not create workspace directory <" << wsdir << ">! "  << endl;
+                if (opt.count("debug")) {
+                    cerr << "Debug: uid: " << getuid() << " euid: " << geteuid() << " " << strerror(err) << endl;
+                }
+                exit(-1);
+            }
+
+            /*
+            // removed 3.6.2020, what was it good for??
+            if(prefix.length()>0) {  // in case we have a prefix, we change owner of that one
+                chown(wsdir_nopostfix.c_str(), tuid, tgid);
+            }
+            */
+
+            // chown clears S_ISGID, so mode comes last
+            if(fchown(wsfd, tuid, tgid)) {
+                cerr << "Error: could not change owner of workspace!" << endl;
+                unlink(wsdir.c_str());
+                exit(-1);
+            }
+
+            if(fchmod(wsfd, mode)) {
+                cerr << "Error: could not change permissions of workspace!" << endl;
+                unlink(wsdir.c_str());
+                exit(-1);
+            }
+            close(wsfd);
         }
-        lower_cap(CAP_FOWNER, db_uid);
 
         extension = maxextensions;
         expiration = time(NULL)+duration*24*3600;
         string primarygroup;
         if (opt.count("group")) {
-            struct group *grp;
-            grp=getgrgid(getegid());
-            // grp should be ok here, was validated before
-            primarygroup = string(grp->gr_name);
+            // should be ok here, was validated before
+            primarygroup = NssCache::getgroupname(getegid());
         }
 
 		if (groupname!="") {
@@ -462,6 +577,39 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 
 }
 
+/*
+ * leave a ticket in the spool of the DB, ws_expirer deletes the tree and the DB entry
+ */
+bool Workspace::queue_deletion(const string wstargetname)
+{
+    DelTicket ticket;
+    ticket.id = fs::path(wstargetname).filename().string();
+    ticket.workspace = wstargetname;
+    ticket.user = username;
+    ticket.queued = time(NULL);
+    DelSpool spool(config.getfs(filesystem).database);
+
+    bool ok;
+    {
+#ifdef SETUID
+        // for filesystem with root_squash, we need to be DB user here
+        FsCred dbcred(db_uid, db_gid);
+#else
+        // the user can not become DB user here, a spool made now would be the user's and is
+        // refused, so it has to exist already
+        CapScope caps({CAP_DAC_OVERRIDE, CAP_CHOWN}, __LINE__, __FILE__);
+#endif
+        ok = spool.enqueue(ticket, db_uid, db_gid);
+    }
+
+    if (ok) {
+        syslog(LOG_INFO, "queued deletion of <%s> for user <%s>.", wstargetname.c_str(), username.c_str());
+    } else {
+        cerr << "Warning: could not queue the deletion." << endl;
+    }
+    return ok;
+}
+
 /*
  * release a workspace by moving workspace and DB entry into trash
  *
@@ -469,8 +617,8 @@ void Workspace::allocate(const string name, const bool extensionflag, const int
 void Workspace::release(string name) {
     string wsdir;
 
-    int dbuid = config["dbuid"].as<int>();
-    int dbgid = config["dbgid"].as<int>();
+    int dbuid = db_uid;
+    int dbgid = db_gid;
 
     string userprefix;
 
@@ -481,12 +629,12 @@ void Workspace::release(string name) {
         userprefix=username+"-";
     }
 
-    string dbfilename=config["workspaces"][filesystem]["database"].as<string>()+"/"+userprefix+name;
+    string dbfilename=config.getfs(filesystem).database+"/"+userprefix+name;
 
     // does db entry exist?
     // cout << "file: " << dbfilename << endl;
     if(fs::exists(dbfilename)) {
-        WsDB dbentry(dbfilename,  config["dbuid"].as<int>(),  config["dbgid"].as<int>());
+        WsDB dbentry(dbfilename, db_uid, db_gid);
         wsdir = dbentry.getwsdir();
 
         string timestamp = lexical_cast<string>(time(NULL));
@@ -495,33 +643,46 @@ void Workspace::release(string name) {
         dbentry.setexpiration(time(NULL));
         // set released flag so released workspaces can be distinguished from expired ones
     	dbentry.setreleased(time(NULL));
-        dbentry.write_dbfile();
 
         string dbtargetname = fs::path(dbfilename).parent_path().string() + "/" +
-                              config["workspaces"][filesystem]["deleted"].as<string>() +
+                              config.getfs(filesystem).deleted +
                               "/" + userprefix + name + "-" + timestamp;
         // cout << dbfilename.c_str() << "-" << dbtargetname.c_str() << endl;
-        raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
-        raise_cap(CAP_FOWNER, __LINE__, __FILE__);
+        {
 #ifdef SETUID
-        // for filesystem with root_squash, we need to be DB user here
-        if(setegid(dbgid) || seteuid(dbuid)) {
-			cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
-			exit(-1);
-		}
+            // for filesystem with root_squash, we need to be DB user here
+            FsCred dbcred(dbuid, dbgid);
+#else
+            CapScope caps({CAP_DAC_OVERRIDE, CAP_FOWNER, CAP_CHOWN}, __LINE__, __FILE__);
 #endif
-        if(rename(dbfilename.c_str(), dbtargetname.c_str())) {
-            // cerr << "rename " << dbfilename.c_str() << " -> " << dbtargetname.c_str() << " failed" << endl;
-            lower_cap(CAP_DAC_OVERRIDE, config["dbuid"].as<int>());
-            lower_cap(CAP_FOWNER, config["dbuid"].as<int>());
-            cerr << "Error: database entry could not be deleted." << endl;
-            exit(-1);
+            // both indices have to be opened before the directories change, the entry
+            // is written, moved and indexed relative to them
+            WsIndex dbindex(fs::path(dbfilename).parent_path().string());
+            WsIndex deletedindex(fs::path(dbtargetname).parent_path().string());
+            dbentry.write_dbfile(&dbindex);
+            string dbid = fs::path(dbfilename).filename().string();
+            string dbtargetid = fs::path(dbtargetname).filename().string();
+            int r;
+            if (dbindex.getdirfd() >= 0 && deletedindex.getdirfd() >= 0) {
+                PathStats::names() += 2;
+                r = renameat(dbindex.getdirfd(), dbid.c_str(), deletedindex.getdirfd(), dbtargetid.c_str());
+            } else {
+                PathStats::paths() += 2;
+                r = rename(dbfilename.c_str(), dbtargetname.c_str());
+            }
+            if(r) {
+                // cerr << "rename " << dbfilename.c_str() << " -> " << dbtargetname.c_str() << " failed" << endl;
+                cerr << "Error: database entry could not be deleted." << endl;
+                exit(-1);
+            }
+            dbindex.remove(dbid);
+            deletedindex.put(dbentry.getindexentry(dbtargetname, deletedindex.getdirfd()));
+            dbindex.commit(dbuid, dbgid);
+            deletedindex.commit(dbuid, dbgid);
         }
         if (opt.count("debug")) {
             cerr << "Debug: lower cap after db rename" << endl;
         }
-        lower_cap(CAP_DAC_OVERRIDE, config["dbuid"].as<int>());
-        lower_cap(CAP_FOWNER, config["dbuid"].as<int>());
 
         // rational: we move the workspace into deleted directory and append a timestamp to name
         // as a new workspace could have same name and releasing the new one would lead to a name
@@ -529,7 +690,7 @@ void Workspace::release(string name) {
 
 
         string wstargetname = fs::path(wsdir).parent_path().string() + "/" +
-                              config["workspaces"][filesystem]["deleted"].as<string>() +
+                              config.getfs(filesystem).deleted +
                               "/" + userprefix + name + "-" + timestamp;
        
         // FIXME when a prefix is used, this is the wrong place!!!
@@ -542,70 +703,95 @@ void Workspace::release(string name) {
 */
 
         // cout << wsdir.c_str() << " - " << wstargetname.c_str() << endl;
-        raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
-        if(rename(wsdir.c_str(), wstargetname.c_str())) {
-            // cerr << "rename " << wsdir.c_str() << " -> " << wstargetname.c_str() << " failed " << geteuid() << " " << getuid() << endl;
-
-            // fallback to mv for filesystems where rename() of directories returns EXDEV
-            int r = mv(wsdir.c_str(), wstargetname.c_str());
-            if(r!=0) {
-                lower_cap(CAP_DAC_OVERRIDE, config["dbuid"].as<int>());
-                cerr << "Error: could not remove workspace!" << endl;
-                exit(-1);
+        {
+            CapScope caps({CAP_DAC_OVERRIDE}, __LINE__, __FILE__);
+            // the space is looked up once, workspace and deleted directory are in it
+            string spacedir = fs::path(wsdir).parent_path().string();
+            string wsid = fs::path(wsdir).filename().string();
+            string wstargetid = config.getfs(filesystem).deleted + "/" + fs::path(wstargetname).filename().string();
+            PathStats::paths()++;
+            int spacefd = open(spacedir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+            int r;
+            if (spacefd >= 0) {
+                PathStats::names() += 2;
+                r = renameat(spacefd, wsid.c_str(), spacefd, wstargetid.c_str());
+                close(spacefd);
+            } else {
+                PathStats::paths() += 2;
+                r = rename(wsdir.c_str(), wstargetname.c_str());
+            }
+            if(r) {
+                // cerr << "rename " << wsdir.c_str() << " -> " << wstargetname.c_str() << " failed " << geteuid() << " " << getuid() << endl;
+
+                // fallback to mv for filesystems where rename() of directories returns EXDEV
+                r = mv(wsdir.c_str(), wstargetname.c_str());
+                if(r!=0) {
+                    cerr << "Error: could not remove workspace!" << endl;
+                    exit(-1);
+                }
             }
         }
         if (opt.count("debug")) {
             cerr << "Debug: lower cap after rename" << endl;
         }
-        lower_cap(CAP_DAC_OVERRIDE, config["dbuid"].as<int>());
 
         syslog(LOG_INFO, "release for user <%s> from <%s> to <%s> done, moved DB entry from <%s> to <%s>.", username.c_str(), wsdir.c_str(), wstargetname.c_str(), dbfilename.c_str(), dbtargetname.c_str());
 
-		// wipe the data if the user wants that
-		if(opt.count("delete-data")) {
+		// wipe the data if the user wants that, in the background by ws_expirer,
+		// or here if the ticket can not be written
+		if(opt.count("delete-data") && queue_deletion(wstargetname)) {
+			cerr << "Info: deletion of the data is queued, ws_release --status shows the progress" << endl;
+		} else if(opt.count("delete-data")) {
 			cerr << "Info: deleting files in workspace as --delete-data was given" << endl;
 			cerr << "Info: you have 5 seconds to interrupt with CTRL-C to prevent deletion" << endl;
 			sleep(5);
 
-        	raise_cap(CAP_FOWNER, __LINE__, __FILE__);
-#ifdef SETUID
-			// get process owner, to be allowd to delete files
-			if(seteuid(getuid())) {
-				cerr << "Error: can not setuid, ad installation?" << endl;
-			}
-#endif
-			boost::system::error_code ec;	
-			auto filecount = fs::remove_all(fs::path(wstargetname), ec);
-			
-			// we expect an error 13 for the topmost directory
-			if (ec.value() != 13) {
-				cerr << "Error: unexpected error " << ec << endl;
+			// settings of the deletion engine, workspace overrides global
+			DelTree deltree(config.getfs(filesystem).deldir_threads, config.getfs(filesystem).deldir_rate);
+			deltree.settarget(config.getfs(filesystem).deldir_latency);
+			DelStats stats;
+			{
+				// as process owner, to be allowed to delete files, the threads of
+				// the deletion inherit the ids
+				CapScope caps({CAP_FOWNER}, __LINE__, __FILE__);
+				FsCred usercred(getuid(), getgid());
+				deltree.remove(wstargetname);
+				stats = deltree.getstats();
 			}
 
-#ifdef SETUID
-			// get root so we can drop again
-			if(seteuid(0)) {
-				cerr << "Error: can not setuid, ad installation?" << endl;
+			// we expect an error 13 for the topmost directory
+			if (deltree.getfirstunexpected() != 0) {
+				cerr << "Error: unexpected error " << strerror(deltree.getfirstunexpected()) << endl;
 			}
-#endif
-        	lower_cap(CAP_FOWNER, config["dbuid"].as<int>());
 		
 			// remove what is left as DB user (could be done by ws_expirer)
-			filecount += fs::remove_all(fs::path(wstargetname), ec);
-
-			cerr << "Info: deleted " << filecount << " files" << endl;
-        	syslog(LOG_INFO, "delete-data for user <%s> from <%s> removed %ld files." , username.c_str(), wstargetname.c_str(), filecount);
+			deltree.remove(wstargetname);
+			DelStats dbstats = deltree.getstats();
+			stats.files += dbstats.files;
+			stats.dirs += dbstats.dirs;
+			stats.bytes += dbstats.bytes;
+			stats.seconds += dbstats.seconds;
+
+			cerr << "Info: deleted " << stats.files << " files and " << stats.dirs << " directories ("
+				 << stats.bytes << " bytes) in " << stats.seconds << " seconds" << endl;
+			if (opt.count("debug") && dbstats.throttle.ops > 0) {
+				cerr << "debug: rate " << dbstats.throttle.rate << " ops/s, " << dbstats.throttle.inflight
+					 << " in flight, latency p50 " << dbstats.throttle.p50 << "s p90 " << dbstats.throttle.p90
+					 << "s p99 " << dbstats.throttle.p99 << "s" << endl;
+			}
+        	syslog(LOG_INFO, "delete-data for user <%s> from <%s> removed %ld files, %ld directories, %llu bytes in %.1f seconds." ,
+				   username.c_str(), wstargetname.c_str(), stats.files, stats.dirs, stats.bytes, stats.seconds);
 
 			// delete DB entry as last step
-			raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
+			{
 #ifdef SETUID
-			// for filesystem with root_squash, we need to be DB user here
-			if (setegid(dbgid) || seteuid(dbuid)) {
-				cerr << "Error: can not setuid, ad installation?" << endl;
-			}
+				// for filesystem with root_squash, we need to be DB user here
+				FsCred dbcred(dbuid, dbgid);
+#else
+				CapScope caps({CAP_DAC_OVERRIDE}, __LINE__, __FILE__);
 #endif
-			fs::remove(fs::path(dbtargetname.c_str()));
-        	lower_cap(CAP_DAC_OVERRIDE, config["dbuid"].as<int>());
+				fs::remove(fs::path(dbtargetname.c_str()));
+			}
         	syslog(LOG_INFO, "removed db entry <%s> for user <%s>." , dbtargetname.c_str(), username.c_str());
         }
 
@@ -618,44 +804,42 @@ void Workspace::release(string name) {
 
 
 /*
- *  validate the commandline versus the configuration file, to see if the user
- *  is allowed to do what he asks for.
+ * names of all groups of the user and name of current group, exits if the current group has no name
  */
-void Workspace::validate(const whichclient wc, YAML::Node &config, YAML::Node &userconfig,
-                         po::variables_map &opt, string &filesystem, int &duration, int &maxextensions, string &primarygroup)
+void Workspace::getgroupnames(vector<string> &groupnames, string &primarygroup)
 {
-
-    // get user name, group names etc
-    vector<string> groupnames;
-
-    struct group *grp;
-    int ngroups = 128;
-    gid_t gids[128];
-    int nrgroups;
-
-    nrgroups = getgrouplist(username.c_str(), getgid(), gids, &ngroups);
-    if(nrgroups == -1) {
-        cerr << "Error: user in too many groups!" << endl;
-        exit(-1);
-    }
-    for(int i=0; i<nrgroups; i++) {
-        grp=getgrgid(gids[i]);
-        if(grp) {
-			groupnames.push_back(string(grp->gr_name));
-			if (opt.count("debug")) {
-				cerr << "debug: secondary group " << string(grp->gr_name) << endl; 
-			}
-		}
+    for(auto const &grp: NssCache::getgroups(username, getgid())) {
+        if(grp.name != "") groupnames.push_back(grp.name);
     }
     // get current group
-    grp=getgrgid(getgid());
-    if (grp==NULL) {
+    primarygroup = NssCache::getgroupname(getgid());
+    if(primarygroup == "") {
         cerr << "Error: user has no group anymore!" << endl;
         exit(-1);
     }
-    primarygroup=string(grp->gr_name);
 
     if (opt.count("debug")) {
+        long hits, misses;
+        NssCache::getstats(hits, misses);
+        cerr << "debug: nss cache hits=" << hits << " misses=" << misses << endl;
+    }
+}
+
+/*
+ *  validate the commandline versus the configuration file, to see if the user
+ *  is allowed to do what he asks for.
+ */
+void Workspace::validate(const whichclient wc, po::variables_map &opt, string &filesystem, int &duration, int &maxextensions, string &primarygroup)
+{
+
+    // get user name, group names etc
+    vector<string> groupnames;
+    getgroupnames(groupnames, primarygroup);
+
+    if (opt.count("debug")) {
+        for(string grp: groupnames) {
+            cerr << "debug: secondary group " << grp << endl;
+        }
         cerr << "debug: primarygroup=" << primarygroup << endl;
     }
 
@@ -673,37 +857,23 @@ void Workspace::validate(const whichclient wc, YAML::Node &config, YAML::Node &u
             cerr << "debug: filesystem given: " << opt["filesystem"].as<string>() << endl;
         }
         
-        // check ACLs
-        vector<string>user_acl;
-        vector<string>group_acl;
-
         // check if filesystem is valid
-        if (!config["workspaces"][opt["filesystem"].as<string>()]) {
+        if (!config.hasfs(opt["filesystem"].as<string>())) {
 			cerr << "Error: please specify an existing filesystem with -F!" << endl;
             exit(1);
         }
-
-        // read ACL lists
-        if ( config["workspaces"][opt["filesystem"].as<string>()]["user_acl"]) {
-            for(string v: config["workspaces"][opt["filesystem"].as<string>()]["user_acl"].as<vector<string> >())
-                user_acl.push_back(v);
-        }
-
-        if ( config["workspaces"][opt["filesystem"].as<string>()]["group_acl"]) {
-            for(string v: config["workspaces"][opt["filesystem"].as<string>()]["group_acl"].as<vector<string> >())
-                group_acl.push_back(v);
-        }
+        const FilesystemConfig &fsconfig = config.getfs(opt["filesystem"].as<string>());
 
         // check ACLs
         bool userok=true;
-        if(user_acl.size()>0 || group_acl.size()>0) {
+        if(fsconfig.hasacl()) {
             userok=false;
             if (opt.count("debug")) {
                 cerr << "debug: acls non-empty, all user access denied before check." << endl;
             }
         }
 
-        if( find(group_acl.begin(), group_acl.end(), primarygroup) != group_acl.end() ) {
+        if( fsconfig.ingroupacl(primarygroup) ) {
             userok=true;
             if (opt.count("debug")) {
                 cerr << "debug: group found in group acl, access granted." << endl;
@@ -711,7 +881,7 @@ void Workspace::validate(const whichclient wc, YAML::Node &config, YAML::Node &u
         }
 #ifdef CHECK_ALL_GROUPS
         for(string grp: groupnames) {
-            if( find(group_acl.begin(), group_acl.end(), grp) != group_acl.end() ) {
+            if( fsconfig.ingroupacl(grp) ) {
                 userok=true;
                 if (opt.count("debug")) {
                     cerr << "debug: secondary group found in group acl, access granted." << endl;
@@ -720,7 +890,7 @@ void Workspace::validate(const whichclient wc, YAML::Node &config, YAML::Node &u
             }
         }
 #endif
-        if( find(user_acl.begin(), user_acl.end(), username) != user_acl.end() ) {
+        if( fsconfig.inuseracl(username) ) {
             userok=true;
             if (opt.count("debug")) {
                 cerr << "debug: user found in user acl, access granted." << endl;
@@ -737,46 +907,21 @@ void Workspace::validate(const whichclient wc, YAML::Node &config, YAML::Node &u
         if (opt.count("debug")) {
             cerr << "debug: no filesystem given, searching..." << endl;
         }
-        map<string, string>groups_defaults;
-        map<string, string>user_defaults;
-        YAML::Node node = config["workspaces"];
-        for(YAML::const_iterator it = node.begin(); it!=node.end(); ++it ) {
-            // cout << "v=" <<  it->first << endl;
-            std::string v = it->first.as<std::string>();
-            if (opt.count("debug")) {
-                cerr << "debug: searching " << v << endl;
-            }
-            // check permissions during search, has to be repeated later in case
-            // no search performed
-            if(wc==WS_Allocate && !opt.count("extension")) {
-                if( config["workspaces"] [it->first] ["allocatable"] &&
-                    config["workspaces"][it->first]["allocatable"].as<bool>() == false ) {
-                    if (opt.count("debug")) {
-                        cerr << "debug: not allocatable, skipping " << endl;
-                    }
-                    continue;
-                }
-            }
-            if(config["workspaces"][it->first]["groupdefault"]) {
-                for(string u: config["workspaces"][it->first]["groupdefault"].as<vector<string> >())
-                    groups_defaults[u]=v;
-            }
-            if(config["workspaces"][it->first]["userdefault"]) {
-                for(string u: config["workspaces"][it->first]["userdefault"].as<vector<string> >())
-                    user_defaults[u]=v;
-            }
-        }
+        // check permissions during search, has to be repeated later in case
+        // no search performed
+        bool allocatableonly = wc==WS_Allocate && !opt.count("extension");
+        string fsdefault;
 
-        if( user_defaults.count(username) > 0 ) {
-            filesystem=user_defaults[username];
+        if( (fsdefault = config.userdefault(username, allocatableonly)) != "" ) {
+            filesystem=fsdefault;
             if (opt.count("debug")) {
                 cerr << "debug: user default, ending search" << endl;
             }
             goto found;
         }
         // name is misleading, this is current group, not primary group
-        if( groups_defaults.count(primarygroup) > 0 ) {
-            filesystem=groups_defaults[primarygroup];
+        if( (fsdefault = config.groupdefault(primarygroup, allocatableonly)) != "" ) {
+            filesystem=fsdefault;
             if (opt.count("debug")) {
                 cerr << "debug: group default, ending search" << endl;
             }
@@ -784,20 +929,20 @@ void Workspace::validate(const whichclient wc, YAML::Node &config, YAML::Node &u
         }
 #ifdef CHECK_ALL_GROUPS
         for(string grp: groupnames) {
-            if( groups_defaults.count(grp)>0 ) {
-                filesystem=groups_defaults[grp];
+            if( (fsdefault = config.groupdefault(grp, allocatableonly)) != "" ) {
+                filesystem=fsdefault;
                 goto found;
             }
         }
 #endif
         // fallback, if no per user or group default, we use the config default
-		try {
-        	filesystem=config["default"].as<string>();
+		if (config.defaultfs != "") {
+        	filesystem=config.defaultfs;
             if (opt.count("debug")) {
                 cerr << "debug: fallback, using global default, ending search" << endl;
             }
           goto found;
-		} catch (...) {
+		} else {
 			cerr << "Error: please specify a valid filesystem with -F!" << endl;
             exit(1);
 		}
@@ -812,16 +957,7 @@ found:
 
     if(wc==WS_Allocate) {
         // check durations - userexception in workspace/workspace/global
-        int configduration;
-        if(userconfig["workspaces"][filesystem]["userexceptions"][username]["duration"]) {
-            configduration = userconfig["workspaces"][filesystem]["userexceptions"][username]["duration"].as<int>();
-        } else {
-            if(config["workspaces"][filesystem]["duration"]) {
-                configduration = config["workspaces"][filesystem]["duration"].as<int>();
-            } else {
-                configduration = config["duration"].as<int>();
-            }
-        }
+        int configduration = config.getfs(filesystem).getduration(username);
 
         // if we are root, we ignore the limits, check for negativ duration as well
         //if ( getuid()!=0 && ( (opt["duration"].as<int>() > configduration) || (opt["duration"].as<int>() < 0) ) ) {
@@ -833,36 +969,31 @@ found:
         }
 
         // get extensions from workspace or default  - userexception in workspace/workspace/global
-        if(userconfig["workspaces"][filesystem]["userexceptions"][username]["maxextensions"]) {
-            maxextensions = userconfig["workspaces"][filesystem]["userexceptions"][username]["maxextensions"].as<int>();
-        } else {
-            if(config["workspaces"][filesystem]["maxextensions"]) {
-                maxextensions = config["workspaces"][filesystem]["maxextensions"].as<int>();
-            } else {
-                maxextensions = config["maxextensions"].as<int>();
-            }
-        }
+        maxextensions = config.getfs(filesystem).getmaxextensions(username);
     }
 }
 
 /*
  * fallback for rename in case of EXDEV
- * we do not use system() as we are in setuid
- * and it would fail, and it sucks anyhow,
+ * copies the tree in parallel and removes the source afterwards,
+ * source and target are full paths, target may not exist
  */
 int Workspace::mv(const char * source, const char *target) {
-    pid_t pid;
-    int status;
-    pid = fork();
-    if (pid==0) {
-        execl("/bin/mv", "mv", source, target, NULL);
-    } else if (pid<0) {
-        //
+    int threads = config.getfs(filesystem).mv_threads;
+
+    cerr << "Info: moving data between filesystems, this can take a while." << endl;
+    MoveTree mover(threads, 10);
+    int ret = mover.move(source, target);
+    MoveStats stats = mover.getstats();
+    if (ret) {
+        cerr << "Error: moving <" << source << "> failed: " << strerror(ret) << endl;
     } else {
-        waitpid(pid, &status, 0);
-        return WEXITSTATUS(status);
+        cerr << "Info: moved " << stats.files << " files and " << stats.dirs << " directories ("
+             << stats.bytes << " bytes) in " << stats.seconds << " seconds" << endl;
     }
-    return 0;
+    syslog(LOG_INFO, "mv from <%s> to <%s> %s, copied %ld files, %ld directories, %llu bytes in %.1f seconds.",
+           source, target, ret ? "failed" : "done", stats.files, stats.dirs, stats.bytes, stats.seconds);
+    return ret;
 }
 
 
@@ -903,26 +1034,24 @@ string Workspace::getfilesystem()
  * restore a workspace, argument is name of workspace DB entry including username and timestamp, form user-name-timestamp
  */
 void Workspace::restore(const string name, const string target, const string username) {
-    string dbfilename = fs::path(config["workspaces"][filesystem]["database"].as<string>()).string()
-                         + "/" + config["workspaces"][filesystem]["deleted"].as<string>()+"/"+name;
+    string dbfilename = config.getfs(filesystem).database
+                         + "/" + config.getfs(filesystem).deleted+"/"+name;
 
-    string targetdbfilename = fs::path(config["workspaces"][filesystem]["database"].as<string>()).string()
+    string targetdbfilename = config.getfs(filesystem).database
                             + "/" + username + "-" + target;
 
     string targetwsdir;
 
     // FIXME should root be able to override this?
-    if (config["workspaces"][filesystem]["restorable"]) {
-        if (config["workspaces"][filesystem]["restorable"].as<bool>() == false) {
-            cerr << "Error: it is not possible to restore workspaces in this filesystem." << endl;
-            exit(1);
-        }
+    if (!config.getfs(filesystem).restorable) {
+        cerr << "Error: it is not possible to restore workspaces in this filesystem." << endl;
+        exit(1);
     }
 
 
     // check for target existance and get directory name of workspace, which will be target of mv operations
     if(fs::exists(targetdbfilename)) {
-        WsDB targetdbentry(targetdbfilename, config["dbuid"].as<int>(),  config["dbgid"].as<int>());
+        WsDB targetdbentry(targetdbfilename, db_uid,  db_gid);
         targetwsdir = targetdbentry.getwsdir();
     } else {
         cerr << "Error: target workspace does not exist!" << endl;
@@ -932,14 +1061,20 @@ void Workspace::restore(const string name, const string target, const string use
         exit(1);
     }
 
+    // data is being deleted by ws_expirer, after ws_release --delete-data
+    if (DelSpool(config.getfs(filesystem).database).hasticket(name)) {
+        cerr << "Error: the data of this workspace is queued for deletion, it can not be restored." << endl;
+        exit(1);
+    }
+
     if(fs::exists(dbfilename)) {
-        WsDB dbentry(dbfilename,  config["dbuid"].as<int>(),  config["dbgid"].as<int>());
+        WsDB dbentry(dbfilename, db_uid, db_gid);
         // this is path of original workspace, from this we derive the deleted name
         string wsdir = dbentry.getwsdir();
 
         // go one up, add deleted subdirectory and add workspace name
         string wssourcename = fs::path(wsdir).parent_path().string() + "/" +
-                              config["workspaces"][filesystem]["deleted"].as<string>() +
+                              config.getfs(filesystem).deleted +
                               "/" + name;
 
         // log restore request
@@ -947,38 +1082,36 @@ void Workspace::restore(const string name, const string target, const string use
 
 	string targetpathname = targetwsdir + "/" + fs::path(wssourcename).filename().string();
 
-        raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
-        raise_cap(CAP_DAC_READ_SEARCH, __LINE__, __FILE__);
+        CapScope caps({CAP_DAC_OVERRIDE, CAP_DAC_READ_SEARCH}, __LINE__, __FILE__);
 
+	PathStats::paths() += 2;
 	int ret = rename(wssourcename.c_str(), targetpathname.c_str());
 	if (ret == -1 && errno == EXDEV) {
 		// #133 for WEKA
-        	ret = mv(wssourcename.c_str(), targetwsdir.c_str()); // does not work with capabilities ?? this needs checking if that comment holds still true
+        	ret = mv(wssourcename.c_str(), targetpathname.c_str()); // does not work with capabilities ?? this needs checking if that comment holds still true
 	}
+        if (ret == 0) {
 #ifdef SETUID
-        // get db user to be able to unlink db entry from root_squash filesystems
-        if(setegid(config["dbgid"].as<int>()) || seteuid(config["dbuid"].as<int>())) {
-			cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
-			exit(-1);
-		}
+            // get db user to be able to unlink db entry from root_squash filesystems
+            FsCred dbcred(db_uid, db_gid);
 #endif
-        if (ret == 0) {
-            unlink(dbfilename.c_str());
+            WsIndex deletedindex(fs::path(dbfilename).parent_path().string());
+            if (deletedindex.getdirfd() >= 0) {
+                PathStats::names()++;
+                unlinkat(deletedindex.getdirfd(), name.c_str(), 0);
+            } else {
+                PathStats::paths()++;
+                unlink(dbfilename.c_str());
+            }
+            deletedindex.remove(name);
+            // appended, ws_restore has no CAP_CHOWN to compact it as DB user
+            deletedindex.commit(db_uid, db_gid);
             syslog(LOG_INFO, "restore for user <%s> from <%s> to <%s> done, removed DB entry <%s>.", username.c_str(), wssourcename.c_str(), targetwsdir.c_str(), dbfilename.c_str());
             cerr << "Info: restore successful, database entry removed." << endl;
         } else {
             syslog(LOG_INFO, "restore for user <%s> from <%s> to <%s> failed, kept DB entry <%s>.", username.c_str(), wssourcename.c_str(), targetwsdir.c_str(), dbfilename.c_str());
             cerr << "Error: moving data failed, database entry kept! " <<  ret << endl;
         }
-#ifdef SETUID
-        if(seteuid(0)||setegid(0)) {
-			cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
-			exit(-1);
-		}
-#endif
-        lower_cap(CAP_DAC_OVERRIDE, config["dbuid"].as<int>());
-        lower_cap(CAP_DAC_READ_SEARCH, config["dbuid"].as<int>());
-
 
     } else {
         cerr << "Error: workspace does not exist." << endl;
@@ -987,258 +1120,76 @@ void Workspace::restore(const string name, const string target, const string use
 
 
 /*
- * drop effective capabilities, except CAP_DAC_OVERRIDE | CAP_CHOWN (FIXME is this comment correct?)
+ * drop all capabilities from the permitted set but the given ones, with SETUID take dbuid as euid
  */
 void Workspace::drop_cap(cap_value_t cap_arg, int dbuid)
 {
-#ifndef SETUID
-    cap_t caps;
-    cap_value_t cap_list[1];
-
-    cap_list[0] = cap_arg;
-
-    caps = cap_init();
-
-    // cap_list[0] = CAP_DAC_OVERRIDE;
-    // cap_list[1] = CAP_CHOWN;
-
-    if (cap_set_flag(caps, CAP_PERMITTED, 1, cap_list, CAP_SET) == -1) {
-        cerr << "Error: problem with capabilities." << endl;
+    if (!CapScope::drop({cap_arg}, dbuid)) {
+        cerr << "Error: problem dropping capabilities. (line " << __LINE__ << ")" << endl;
         exit(1);
     }
-
-    if (cap_set_proc(caps) == -1) {
-        cerr << "Error: problem dropping capabilities." << endl;
-        cap_t cap = cap_get_proc();
-        cerr << "Running with capabilities: " << cap_to_text(cap, NULL) << endl;
-        cap_free(cap);
-        exit(1);
-    }
-
-    cap_free(caps);
-#else
-    // seteuid(0);
-    if(seteuid(dbuid)) {
-        cerr << "Error: can not change uid. (line " << __LINE__ << ")" << endl;
-        exit(1);
-    }
-#endif
 }
 
 void Workspace::drop_cap(cap_value_t cap_arg1, cap_value_t cap_arg2, int dbuid)
 {
-#ifndef SETUID
-    cap_t caps;
-    cap_value_t cap_list[2];
-
-    cap_list[0] = cap_arg1;
-    cap_list[1] = cap_arg2;
-
-    caps = cap_init();
-
-    // cap_list[0] = CAP_DAC_OVERRIDE;
-    // cap_list[1] = CAP_CHOWN;
-
-    if (cap_set_flag(caps, CAP_PERMITTED, 2, cap_list, CAP_SET) == -1) {
-        cerr << "Error: problem with capabilities." << endl;
+    if (!CapScope::drop({cap_arg1, cap_arg2}, dbuid)) {
+        cerr << "Error: problem dropping capabilities. (line " << __LINE__ << ")" << endl;
         exit(1);
     }
-
-    if (cap_set_proc(caps) == -1) {
-        cerr << "Error: problem dropping capabilities." << endl;
-        cap_t cap = cap_get_proc();
-        cerr << "Running with capabilities: " << cap_to_text(cap, NULL) << endl;
-        cap_free(cap);
-        exit(1);
-    }
-
-    cap_free(caps);
-#else
-    // seteuid(0);
-    if(seteuid(dbuid)) {
-        cerr << "Error: can not change uid. (line " << __LINE__ << ")" << endl;
-        exit(1);
-    }
-#endif
-
 }
 
 void Workspace::drop_cap(cap_value_t cap_arg1, cap_value_t cap_arg2, cap_value_t cap_arg3, int dbuid, int srcline, std::string srcfile)
 {
-#ifndef SETUID
-    cap_t caps;
-    cap_value_t cap_list[3];
-
-    cap_list[0] = cap_arg1;
-    cap_list[1] = cap_arg2;
-    cap_list[2] = cap_arg3;
-
-    caps = cap_init();
-
-    // cap_list[0] = CAP_DAC_OVERRIDE;
-    // cap_list[1] = CAP_CHOWN;
-
-    if (cap_set_flag(caps, CAP_PERMITTED, 3, cap_list, CAP_SET) == -1) {
-        cerr << "Error: problem with capabilities." << endl;
-        exit(1);
-    }
-
-    if (cap_set_proc(caps) == -1) {
-        cerr << "Error: problem dropping capabilities." << endl;
-        cap_t cap = cap_get_proc();
-        cerr << "Running with capabilities: " << cap_to_text(cap, NULL) << endl;
-        cap_free(cap);
+    if (!CapScope::drop({cap_arg1, cap_arg2, cap_arg3}, dbuid)) {
+        cerr << "Error: problem dropping capabilities. (line " << __LINE__ << ", from " << srcfile <<":"<<srcline<<")" << endl;
         exit(1);
     }
-
-    cap_free(caps);
-#else
-    // seteuid(0);
-    if(seteuid(dbuid)) {
-        cerr << "Error: can not change uid. (line " << __LINE__ << ", from " << srcfile <<":"<<srcline<<")" << endl;
-	// auto uid=getuid();
-	// auto euid=geteuid();
-	// cerr << "uid: " << uid << " euid: " << euid << endl;
-        exit(1);
-    }
-#endif
-
 }
 
 /*
- * remove a capability from the effective set
+ * print the number of path lookups so far
  */
-void Workspace::lower_cap(int cap, int dbuid)
+void Workspace::print_pathstats()
 {
-#ifndef SETUID
-    cap_t caps;
-    cap_value_t cap_list[1];
-
-    caps = cap_get_proc();
-
-    cap_list[0] = cap;
-    if (cap_set_flag(caps, CAP_EFFECTIVE, 1, cap_list, CAP_CLEAR) == -1) {
-        cerr << "Error: problem with capabilities." << endl;
-        exit(1);
-    }
-
-    if (cap_set_proc(caps) == -1) {
-        cerr << "Error: problem lowering capabilities." << endl;
-        cap_t cap = cap_get_proc();
-        cerr << "Running with capabilities: " << cap_to_text(cap, NULL) << endl;
-        cap_free(cap);
-        exit(1);
-    }
-
-    cap_free(caps);
-#else
-    // seteuid(0);
-
-    if(seteuid(dbuid)) {
-        cerr << "Error: can not change uid. (line " << __LINE__ << ")" << endl;
-        exit(1);
-    }
-#endif
+    cerr << "Debug: " << PathStats::paths() << " path and " << PathStats::names() << " relative name lookups" << endl;
 }
 
 /*
- * add a capability to the effective set
+ * print the number of system calls for capabilities and ids so far
  */
-void Workspace::raise_cap(int cap, int srcline, std::string srcfile)
+void Workspace::print_capstats()
 {
-#ifndef SETUID
-    cap_t caps;
-    cap_value_t cap_list[1];
-
-    caps = cap_get_proc();
-
-    cap_list[0] = cap;
-    if (cap_set_flag(caps, CAP_EFFECTIVE, 1, cap_list, CAP_SET) == -1) {
-        cerr << "Error: problem with capabilities." << endl;
-        exit(1);
-    }
-
-    if (cap_set_proc(caps) == -1) {
-        cerr << "Error: problem raising capabilities." << endl;
-        cap_t caps = cap_get_proc();
-        cerr << "Running with capabilities: " << cap_to_text(caps, NULL) << endl;
-        cap_free(caps);
-	cerr << "raising: " << cap_to_name(cap) << endl;
-        exit(1);
-    }
-
-    cap_free(caps);
-#else
-    if (seteuid(0)) {
-        cerr << "Error: can not change uid. (line " << __LINE__ << ", from " << srcfile <<":"<<srcline<<")" << endl;
-		//auto uid=getuid();
-		//auto euid=geteuid();
-		//cerr << "uid: " << uid << " euid: " << euid << endl;
-        exit(1);
-    }
-#endif
+    long capcalls, idcalls;
+    CapScope::getstats(capcalls, idcalls);
+    cerr << "Debug: " << capcalls << " capability and " << idcalls << " credential system calls" << endl;
 }
 
 std::vector<string> Workspace::get_valid_fslist() {
   vector<string> fslist;
 
-  // get user name, group names etc
+  // get user name, group names etc, served from cache after validate()
   vector<string> groupnames;
-
-  struct group *grp;
-  int ngroups = 128;
-  gid_t gids[128];
-  int nrgroups;
   string primarygroup;
-
-  nrgroups = getgrouplist(username.c_str(), geteuid(), gids, &ngroups);
-  if(nrgroups<=0) {
-      cerr << "Error: user in too many groups!" << endl;
-  }
-  for(int i=0; i<nrgroups; i++) {
-      grp=getgrgid(gids[i]);
-      if(grp) groupnames.push_back(string(grp->gr_name));
-  }
-  // get current group
-  grp=getgrgid(getegid());
-  if(grp==NULL) {
-       cerr << "Error: user has no group anymore!" << endl;
-       exit(-1);
-  }
-  primarygroup=string(grp->gr_name);
+  getgroupnames(groupnames, primarygroup);
 
   // iterate over all filesystems and search the ones allowed for current user
-  YAML::Node node = config["workspaces"];
-  for(YAML::const_iterator it = node.begin(); it!=node.end(); ++it ) {
-      std::string cfilesystem = it->first.as<std::string>();
-      // check ACLs
-      vector<string>user_acl;
-      vector<string>group_acl;
+  for(auto const &fsconfig: config.getfilesystems()) {
+      const std::string &cfilesystem = fsconfig.name;
 
       if (opt.count("debug")) {
           cerr << "debug: find_valid_fs:" << cfilesystem << endl;
       }
 
-      // read ACL lists
-      if ( config["workspaces"][cfilesystem]["user_acl"]) {
-          for(string v: config["workspaces"][cfilesystem]["user_acl"].as<vector<string> >())
-              user_acl.push_back(v);
-      }
-      if ( config["workspaces"][cfilesystem]["group_acl"]) {
-          for(string v: config["workspaces"][cfilesystem]["group_acl"].as<vector<string> >())
-              group_acl.push_back(v);
-      }
-
       // check ACLs
       bool userok=true;
-      if(user_acl.size()>0 || group_acl.size()>0) {
+      if(fsconfig.hasacl()) {
           if (opt.count("debug")) {
               cerr << "debug: find_valid_fs, has ACL, access denied." << endl;
           }
           userok=false;
       }
 
-      if( find(group_acl.begin(), group_acl.end(), primarygroup) != group_acl.end() ) {
+      if( fsconfig.ingroupacl(primarygroup) ) {
           userok=true;
           if (opt.count("debug")) {
               cerr << "debug: find_valid_fs, in group ACL, access granted." << endl;
@@ -1246,7 +1197,7 @@ std::vector<string> Workspace::get_valid_fslist() {
       }
 #ifdef CHECK_ALL_GROUPS
       for(string grp: groupnames) {
-          if( find(group_acl.begin(), group_acl.end(), grp) != group_acl.end() ) {
+          if( fsconfig.ingroupacl(grp) ) {
 			  if (opt.count("debug")) {
 				  cerr << "debug: find_valid_fs, in group ACL, access granted (secondary)." << endl;
 			  }
@@ -1255,7 +1206,7 @@ std::vector<string> Workspace::get_valid_fslist() {
           }
       }
 #endif
-      if( find(user_acl.begin(), user_acl.end(), username) != user_acl.end() ) {
+      if( fsconfig.inuseracl(username) ) {
           userok=true;
           if (opt.count("debug")) {
               cerr << "debug: find_valid_fs, in user ACL, access granted." << endl;
@@ -44,6 +44,8 @@
 #include <boost/program_options.hpp>
 #include <boost/smart_ptr.hpp>
 
+#include "wsconfig.h"
+
 #ifndef SETUID
 #include <sys/capability.h>
 #else
@@ -54,6 +56,9 @@ const int CAP_DAC_READ_SEARCH=2;
 const int CAP_FOWNER = 3;
 #endif
 
+// directory of precreated workspace directories in each space, kept filled by ws_expirer
+const char WSPOOL_NAME[] = ".pool";
+
 namespace po = boost::program_options;
 
 using namespace std;
@@ -71,19 +76,22 @@ enum whichclient {
 class Workspace {
 
 private:
-    YAML::Node config, userconfig;
+    GlobalConfig config;
     int db_uid, db_gid;
     po::variables_map opt;
     int maxextensions, duration;
     string filesystem, acctcode, username;
 
-    void validate(const whichclient wc, YAML::Node &config, YAML::Node &userconfig,
-                  po::variables_map &opt, string &filesystem, int &duration, int &maxextensions, string &primarygroup);
+    void validate(const whichclient wc, po::variables_map &opt, string &filesystem, int &duration, int &maxextensions, string &primarygroup);
 
 
     int mv(const char * source, const char *target);
 
+    // ticket for ws_expirer to delete a released workspace, false if it could not be written
+    bool queue_deletion(const string wstargetname);
+
     std::vector<string> get_valid_fslist();
+    void getgroupnames(vector<string> &groupnames, string &primarygroup);
 
 public:
 
@@ -93,8 +101,9 @@ public:
     static void drop_cap(cap_value_t cap_arg, int dbuid);
     static void drop_cap(cap_value_t cap_arg1, cap_value_t cap_arg2, int dbuid);
     static void drop_cap(cap_value_t cap_arg1, cap_value_t cap_arg2, cap_value_t cap_arg3, int dbuid, int srcline, std::string srcfile);
-    static void raise_cap(int cap, int srcline, std::string srcfile);
-    static void lower_cap(int cap, int dbuid);
+    // raising and lowering is done by CapScope, see fscred.h
+    static void print_capstats();
+    static void print_pathstats();
 
     // constructor reads config and userconfig
     Workspace(const whichclient clientcode, const po::variables_map opt, const int _duration, string filesystem);
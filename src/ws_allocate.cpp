@@ -53,6 +53,9 @@
 
 
 #include "ws.h"
+#include "wsconfig.h"
+#include "fscred.h"
+#include "wsd.h"
 
 namespace po = boost::program_options;
 using namespace std;
@@ -249,10 +252,10 @@ void commandline(po::variables_map &opt, string &name, int &duration, const int
 
 
 /*
- *  main logic here
+ *  main logic here, called by main() or by wsd
  */
 
-int main(int argc, char **argv) {
+int ws_allocate(int argc, char **argv) {
     int duration, durationdefault;
     bool extensionflag;
     string name;
@@ -275,30 +278,33 @@ int main(int argc, char **argv) {
     // read config (for dbuid, reminder and duration default only)
     YAML::Node config;
     try {
-        config = YAML::LoadFile("/etc/ws.conf");
+        config = WsConfig::load("/etc/ws.conf");
     } catch (const YAML::BadFile& e) {
         cerr << "Error: Could not read config file!" << endl;
         cerr << e.what() << endl;
         exit(-1);
     }
 
-    reminderdefault = config["reminderdefault"].as<int>(0);
-    durationdefault = config["durationdefault"].as<int>(1);
+    GlobalConfig gconfig(config, YAML::Node());
+    reminderdefault = gconfig.reminderdefault;
+    durationdefault = gconfig.durationdefault;
 
-    // read user config before dropping privileges to DB user
-    //
-    // get user first, so user config is read as owner
-    // of files, which is needed for root_squash homes
-    Workspace::drop_cap(CAP_DAC_OVERRIDE, CAP_CHOWN, CAP_FOWNER, getuid(), __LINE__, __FILE__);
+    // lower capabilities to minimum, threads can still act as DB group
+    FsCred::keepgid(gconfig.dbgid);
+    Workspace::drop_cap(CAP_DAC_OVERRIDE, CAP_CHOWN, CAP_FOWNER, gconfig.dbuid, __LINE__, __FILE__);
 
+    // read user config as owner of the files, which is needed for root_squash homes
     std::stringstream user_conf;
-    string user_conf_filename = Workspace::getuserhome()+"/.ws_user.conf";
-    if (!boost::filesystem::is_symlink(user_conf_filename)) {
-        std::ifstream t(user_conf_filename.c_str());
-        user_conf << t.rdbuf();
-    } else {
-        cerr << "Error: ~/.ws_user.conf can not be symlink!" << endl;
-        exit(-1);
+    {
+        FsCred usercred(getuid(), getgid());
+        string user_conf_filename = Workspace::getuserhome()+"/.ws_user.conf";
+        if (!boost::filesystem::is_symlink(user_conf_filename)) {
+            std::ifstream t(user_conf_filename.c_str());
+            user_conf << t.rdbuf();
+        } else {
+            cerr << "Error: ~/.ws_user.conf can not be symlink!" << endl;
+            exit(-1);
+        }
     }
 
     // check commandline, get flags which are used to create ws object or for workspace allocation
@@ -312,5 +318,19 @@ int main(int argc, char **argv) {
     
     // allocate workspace
     ws.allocate(name, extensionflag, reminder, mailaddress, user_option, groupname, comment);
-    
+    if (opt.count("debug")) {
+        Workspace::print_capstats();
+        Workspace::print_pathstats();
+    }
+
+    return 0;
+}
+
+#ifndef WSD
+int main(int argc, char **argv) {
+    // wsd does the work if it runs
+    WsdClient::delegate("ws_allocate", argc, argv);
+
+    return ws_allocate(argc, argv);
 }
+#endif
@@ -0,0 +1,122 @@
+/*
+ *  workspace++
+ *
+ *  ws_compile_config
+ *
+ *  write binary snapshots of the configuration files, only for root
+ *
+ *  the snapshots are read by ws_allocate, ws_release and ws_restore instead of parsing
+ *  the YAML files, as long as the YAML files are not changed. After a change of the
+ *  configuration, this has to be called again, until then the YAML files are used.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <boost/program_options.hpp>
+
+#include "wsconfig.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+int main(int argc, char **argv) {
+    po::variables_map opt;
+    vector<string> files;
+
+    po::options_description cmd_options( "\nOptions" );
+    cmd_options.add_options()
+            ("help,h", "produce help message")
+            ("version,V", "show version")
+            ("check,c", "only check if snapshots are up to date")
+            ("file", po::value<vector<string>>(&files), "config files, default /etc/ws.conf and /etc/ws_private.conf")
+    ;
+    po::positional_options_description p;
+    p.add("file", -1);
+
+    try{
+        po::store(po::command_line_parser(argc, argv).options(cmd_options).positional(p).run(), opt);
+        po::notify(opt);
+    } catch (...) {
+        cout << "Usage:" << argv[0] << ": [options] [configfile...]" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+
+    if (opt.count("help")) {
+        cout << "Usage:" << argv[0] << ": [options] [configfile...]" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+
+    if (opt.count("version")) {
+#ifdef IS_GIT_REPOSITORY
+        cout << "workspace build from git commit hash " << GIT_COMMIT_HASH
+             << " on top of release " << WS_VERSION << endl;
+#else
+        cout << "workspace version " << WS_VERSION << endl;
+#endif
+        exit(1);
+    }
+
+    if (files.empty()) {
+        files.push_back("/etc/ws.conf");
+        // private config is optional
+        if (access("/etc/ws_private.conf", F_OK) == 0) {
+            files.push_back("/etc/ws_private.conf");
+        }
+    }
+
+    int ret = 0;
+    for (auto const &f : files) {
+        if (opt.count("check")) {
+            try {
+                WsConfig::load(f);
+            } catch (const YAML::Exception &e) {
+                cerr << "Error: could not read " << f << ": " << e.what() << endl;
+                ret = 1;
+                continue;
+            }
+            if (WsConfig::fromsnapshot(f)) {
+                cout << WsConfig::snapshotname(f) << " is up to date" << endl;
+            } else {
+                cout << WsConfig::snapshotname(f) << " is missing or outdated" << endl;
+                ret = 1;
+            }
+            continue;
+        }
+        if (geteuid() != 0) {
+            cerr << "Error: only root can write config snapshots, they would be ignored otherwise." << endl;
+            exit(-1);
+        }
+        string error;
+        if (WsConfig::compile(f, error)) {
+            cout << "wrote " << WsConfig::snapshotname(f) << endl;
+        } else {
+            cerr << "Error: " << error << endl;
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
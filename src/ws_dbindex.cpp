@@ -0,0 +1,284 @@
+/*
+ *  workspace++
+ *
+ *  ws_dbindex
+ *
+ *  maintenance of the sidecar index of the workspace DB, only for root or the DB user
+ *
+ *  rebuilds the index of each DB directory and its deleted directory from the YAML files,
+ *  updates it after changes by ws_expirer, which also compacts the log appended by the tools,
+ *  checks index against the YAML files or dumps it.
+ *
+ *  update keeps the entries of the old index, even if it is outdated, drops entries no longer
+ *  in the directory and reads only new ones. Entries changed in place are not noticed, that
+ *  is what rebuild is for.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <syslog.h>
+#include <unistd.h>
+#include <boost/program_options.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include "wsdb.h"
+#include "wsindex.h"
+#include "wsconfig.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+/*
+ *  parse the commandline
+ */
+void commandline(po::variables_map &opt, string &filesystem, int argc, char**argv) {
+    po::options_description cmd_options( "\nOptions" );
+    cmd_options.add_options()
+            ("help,h", "produce help message")
+            ("version,V", "show version")
+            ("filesystem,F", po::value<string>(&filesystem), "filesystem, default is all")
+            ("rebuild", "rebuild index from DB entries")
+            ("update", "update index, read only DB entries not in the index")
+            ("check", "compare index with DB entries")
+            ("dump", "print index")
+    ;
+
+    try{
+        po::store(po::command_line_parser(argc, argv).options(cmd_options).run(), opt);
+        po::notify(opt);
+    } catch (...) {
+        cout << "Usage:" << argv[0] << ": [options]" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+
+    if (opt.count("version")) {
+#ifdef IS_GIT_REPOSITORY
+        cout << "workspace build from git commit hash " << GIT_COMMIT_HASH
+             << " on top of release " << WS_VERSION << endl;
+#else
+        cout << "workspace version " << WS_VERSION << endl;
+#endif
+        exit(1);
+    }
+
+    if (opt.count("help") || (opt.count("rebuild") + opt.count("update") + opt.count("check") + opt.count("dump")) != 1) {
+        cout << "Usage:" << argv[0] << ": [options]" << endl;
+        cout << "  one of --rebuild, --update, --check or --dump is required" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+}
+
+
+/*
+ * read all DB entries of dbdir
+ */
+map<string, WsIndexEntry> scan(const string dbdir, int dbuid, int dbgid)
+{
+    map<string, WsIndexEntry> entries;
+    for (auto const &id : WsIndex::list_dbdir(dbdir)) {
+        string filename = dbdir + "/" + id;
+        WsDB entry(filename, dbuid, dbgid, false);
+        if (entry.isvalid()) {
+            entries[id] = entry.getindexentry(filename);
+        } else {
+            cerr << "Warning: invalid DB entry <" << filename << ">, not indexed." << endl;
+        }
+    }
+    return entries;
+}
+
+bool sameentry(const WsIndexEntry &a, const WsIndexEntry &b)
+{
+    return a.id == b.id && a.workspace == b.workspace && a.group == b.group && a.acctcode == b.acctcode &&
+           a.mailaddress == b.mailaddress && a.comment == b.comment && a.expiration == b.expiration &&
+           a.released == b.released && a.extensions == b.extensions && a.reminder == b.reminder &&
+           a.flags == b.flags;
+}
+
+/*
+ * handle one DB directory, returns false on problems
+ */
+bool dodir(po::variables_map &opt, const string dbdir, int dbuid, int dbgid)
+{
+    WsIndex index(dbdir);
+
+    if (opt.count("rebuild")) {
+        index.clear();
+        for (auto const &it : scan(dbdir, dbuid, dbgid)) {
+            index.put(it.second);
+        }
+        if (!index.commit(dbuid, dbgid)) {
+            if (!index.isfresh()) {
+                cerr << "Error: <" << dbdir << "> changed while it was read, index removed, please run again." << endl;
+            } else {
+                cerr << "Error: could not write index in <" << dbdir << ">." << endl;
+            }
+            return false;
+        }
+        cout << "rebuilt index of <" << dbdir << "> with " << index.getentries().size() << " entries" << endl;
+        syslog(LOG_INFO, "rebuilt index of <%s> with %ld entries.", dbdir.c_str(), (long)index.getentries().size());
+        return true;
+    }
+
+    if (opt.count("update")) {
+        WsIndexReader old(dbdir, false);
+        index.clear();
+        long read = 0;
+        for (auto const &id : WsIndex::list_dbdir(dbdir)) {
+            WsIndexEntry e;
+            if (old.find(id, e)) {
+                index.put(e);
+                continue;
+            }
+            string filename = dbdir + "/" + id;
+            WsDB entry(filename, dbuid, dbgid, false);
+            if (entry.isvalid()) {
+                index.put(entry.getindexentry(filename));
+                read++;
+            } else {
+                cerr << "Warning: invalid DB entry <" << filename << ">, not indexed." << endl;
+            }
+        }
+        if (!index.commit(dbuid, dbgid)) {
+            if (!index.isfresh()) {
+                cerr << "Error: <" << dbdir << "> changed while it was read, index removed, please run again." << endl;
+            } else {
+                cerr << "Error: could not write index in <" << dbdir << ">." << endl;
+            }
+            return false;
+        }
+        cout << "updated index of <" << dbdir << "> with " << index.getentries().size() << " entries, "
+             << read << " read" << endl;
+        syslog(LOG_INFO, "updated index of <%s> with %ld entries, %ld read.", dbdir.c_str(),
+               (long)index.getentries().size(), read);
+        return true;
+    }
+
+    // reads the whole index, a broken one is not fresh anymore then
+    auto const &have = index.getentries();
+    if (!index.isfresh()) {
+        cout << "index of <" << dbdir << "> is missing or outdated" << endl;
+        return false;
+    }
+
+    if (opt.count("dump")) {
+        cout << "index of <" << dbdir << ">:" << endl;
+        for (auto const &it : have) {
+            const WsIndexEntry &e = it.second;
+            cout << e.id << " workspace=" << e.workspace << " expiration=" << e.expiration
+                 << " extensions=" << e.extensions << " released=" << e.released
+                 << " group=" << e.group << " acctcode=" << e.acctcode << endl;
+        }
+        return true;
+    }
+
+    // check: compare with a fresh scan, ctime is not compared, it changes with rename
+    bool ok = true;
+    auto const want = scan(dbdir, dbuid, dbgid);
+    for (auto const &it : want) {
+        auto found = have.find(it.first);
+        if (found == have.end()) {
+            cout << "missing in index: " << it.first << endl;
+            ok = false;
+        } else if (!sameentry(found->second, it.second)) {
+            cout << "differs from DB: " << it.first << endl;
+            ok = false;
+        }
+    }
+    for (auto const &it : have) {
+        if (want.find(it.first) == want.end()) {
+            cout << "not in DB: " << it.first << endl;
+            ok = false;
+        }
+    }
+    cout << "index of <" << dbdir << "> is " << (ok ? "ok" : "inconsistent") << endl;
+    return ok;
+}
+
+
+int main(int argc, char **argv) {
+    po::variables_map opt;
+    string filesystem;
+    YAML::Node config;
+
+    setenv("LANG","C",1);
+    setenv("LC_CTYPE","C",1);
+    setenv("LC_ALL","C",1);
+    std::setlocale(LC_ALL, "C");
+    std::locale::global(std::locale("C"));
+
+    commandline(opt, filesystem, argc, argv);
+
+    try {
+        config = WsConfig::load("/etc/ws.conf");
+    } catch (const YAML::BadFile& e) {
+        cerr << "Error: Could not read config file!" << endl;
+        cerr << e.what() << endl;
+        exit(-1);
+    }
+
+    GlobalConfig gconfig(config, YAML::Node());
+    int dbuid = gconfig.dbuid;
+    int dbgid = gconfig.dbgid;
+
+    if (getuid() != 0 && getuid() != (uid_t)dbuid) {
+        cerr << "Error: only root or the DB user can maintain the DB index." << endl;
+        exit(-1);
+    }
+
+    openlog("ws_dbindex", 0, LOG_USER); // SYSLOG
+
+    // for filesystem with root_squash, we need to be DB user here
+    if (geteuid() == 0) {
+        if (setegid(dbgid) || seteuid(dbuid)) {
+            cerr << "Error: can not seteuid or setgid." << endl;
+            exit(-1);
+        }
+    }
+
+    vector<string> filesystems;
+    if (filesystem != "") {
+        if (!gconfig.hasfs(filesystem)) {
+            cerr << "Error: no such filesystem." << endl;
+            exit(-1);
+        }
+        filesystems.push_back(filesystem);
+    } else {
+        for (auto const &fsconfig : gconfig.getfilesystems()) {
+            filesystems.push_back(fsconfig.name);
+        }
+    }
+
+    bool ok = true;
+    for (auto const &fs : filesystems) {
+        string dbdir = gconfig.getfs(fs).database;
+        string deleted = gconfig.getfs(fs).deleted;
+        if (!dodir(opt, dbdir, dbuid, dbgid)) ok = false;
+        if (!dodir(opt, dbdir + "/" + deleted, dbuid, dbgid)) ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
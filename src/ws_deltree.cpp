@@ -0,0 +1,226 @@
+/*
+ *  workspace++
+ *
+ *  ws_deltree
+ *
+ *  deletion of expired workspaces for ws_expirer, only for root
+ *
+ *  deletes a tree with the parallel deleter of ws_release, limited in time. If the time
+ *  limit is reached or SIGTERM/SIGINT is received, the directories not walked yet are
+ *  written to a journal next to the tree (.<name>.deljournal, hidden from the globs of
+ *  ws_expirer), and the next call for the same tree continues from there.
+ *
+ *  with --progress, the counts of all runs so far are written to a file every 5 seconds and
+ *  at the end, for the deletion tickets of ws_release --delete-data (delspool.h).
+ *
+ *  with --estimate, nothing is deleted, a line estimate, files, directories, bytes and exact
+ *  or sampled, separated by tabs, is printed for the plans and the scheduler of ws_expirer.
+ *
+ *  exit code 0 if the tree is gone, 1 on errors, 2 if stopped before the end
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/program_options.hpp>
+
+#include "deltree.h"
+#include "delspool.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+static std::atomic<bool> stopflag(false);
+
+static void stophandler(int)
+{
+    stopflag = true;
+}
+
+
+/*
+ *  parse the commandline
+ */
+void commandline(po::variables_map &opt, string &path, string &progress, int &threads, double &rate, double &latency,
+                 double &timelimit, int argc, char**argv) {
+    po::options_description cmd_options( "\nOptions" );
+    cmd_options.add_options()
+            ("help,h", "produce help message")
+            ("version,V", "show version")
+            ("threads,t", po::value<int>(&threads)->default_value(4), "number of threads")
+            ("rate,r", po::value<double>(&rate)->default_value(0), "maximum metadata operations per second, 0 is unlimited")
+            ("latency", po::value<double>(&latency)->default_value(0), "adapt rate to this latency of metadata operations in seconds, 0 is fixed rate")
+            ("timelimit,l", po::value<double>(&timelimit)->default_value(0), "stop after seconds, 0 is unlimited")
+            ("nojournal", "do not continue from or write a journal")
+            ("progress", po::value<string>(&progress), "write counts to this file while deleting")
+            ("estimate", po::value<long>(), "delete nothing, estimate files and directories reading at most this many directories, stat calls limited by --rate")
+            ("path", po::value<string>(&path), "tree to delete")
+    ;
+    po::positional_options_description p;
+    p.add("path", 1);
+
+    try{
+        po::store(po::command_line_parser(argc, argv).options(cmd_options).positional(p).run(), opt);
+        po::notify(opt);
+    } catch (...) {
+        cout << "Usage:" << argv[0] << ": [options] path" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+
+    if (opt.count("version")) {
+#ifdef IS_GIT_REPOSITORY
+        cout << "workspace build from git commit hash " << GIT_COMMIT_HASH
+             << " on top of release " << WS_VERSION << endl;
+#else
+        cout << "workspace version " << WS_VERSION << endl;
+#endif
+        exit(1);
+    }
+
+    if (opt.count("help") || path == "") {
+        cout << "Usage:" << argv[0] << ": [options] path" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+}
+
+
+int main(int argc, char **argv) {
+    po::variables_map opt;
+    string path, progressfile;
+    int threads;
+    double rate, latency, timelimit;
+
+    commandline(opt, path, progressfile, threads, rate, latency, timelimit, argc, argv);
+
+    if (getuid() != 0) {
+        cerr << "Error: only root can delete workspaces." << endl;
+        exit(-1);
+    }
+
+    // a relative path or a trailing slash would give a journal somewhere else
+    while (path.size() > 1 && path[path.size()-1] == '/') path.erase(path.size()-1);
+    if (path[0] != '/' || path == "/") {
+        cerr << "Error: path has to be absolute and not /." << endl;
+        exit(-1);
+    }
+    size_t slash = path.rfind('/');
+    string journal = path.substr(0, slash + 1) + "." + path.substr(slash + 1) + ".deljournal";
+
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) {
+        // gone, a journal of it is useless now
+        unlink(journal.c_str());
+        cerr << "Error: " << path << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+
+    if (opt.count("estimate")) {
+        TreeEstimate e;
+        if (!estimatetree(path, opt["estimate"].as<long>(), e, rate)) {
+            cerr << "Error: " << path << ": " << strerror(errno) << endl;
+            exit(1);
+        }
+        cout << "estimate\t" << e.files << "\t" << e.dirs << "\t" << e.bytes << "\t" << (e.exact ? "exact" : "sampled") << endl;
+        return 0;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stophandler;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    DelTree deltree(threads, rate);
+    deltree.settarget(latency);
+    deltree.setlimit(timelimit, &stopflag);
+    if (!opt.count("nojournal")) {
+        deltree.setjournal(journal);
+    }
+
+    auto writeprogress = [&](const string state) {
+        DelStats now = deltree.getprogress();
+        DelProgress p;
+        p.state = state;
+        p.updated = time(NULL);
+        p.files = now.files;
+        p.dirs = now.dirs;
+        p.bytes = now.bytes;
+        p.errors = now.errors;
+        if (!DelSpool::writeprogress(progressfile, p)) {
+            cerr << "Warning: could not write progress to " << progressfile << endl;
+        }
+    };
+    std::atomic<bool> done(false);
+    std::thread progress;
+    if (progressfile != "") {
+        writeprogress("deleting");
+        progress = std::thread([&]() {
+            for (int ticks = 1; !done; ticks++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (ticks % 50 == 0 && !done) writeprogress("deleting");
+            }
+        });
+    }
+
+    bool ok = deltree.remove(path);
+
+    if (progress.joinable()) {
+        done = true;
+        progress.join();
+        writeprogress(!deltree.isfinished() ? "stopped" : ok ? "done" : "failed");
+    }
+
+    DelStats stats = deltree.getstats();
+    DelStats previous = deltree.getprevious();
+    if (deltree.getruns() > 0) {
+        cout << "continued after " << deltree.getruns() << " runs with " << previous.files << " files, "
+             << previous.dirs << " directories, " << previous.bytes << " bytes removed" << endl;
+    }
+    cout << "removed " << stats.files << " files, " << stats.dirs << " directories, " << stats.bytes
+         << " bytes in " << stats.seconds << " seconds";
+    if (stats.errors) {
+        cout << ", " << stats.errors << " errors, first: " << strerror(deltree.getfirsterror());
+        if (deltree.getfirstunexpected() != 0 && deltree.getfirstunexpected() != deltree.getfirsterror()) {
+            cout << ", first other than EACCES: " << strerror(deltree.getfirstunexpected());
+        }
+    }
+    cout << endl;
+    if (stats.throttle.ops > 0) {
+        cout << "rate " << stats.throttle.rate << " ops/s, " << stats.throttle.inflight << " in flight, latency p50 "
+             << stats.throttle.p50 << "s p90 " << stats.throttle.p90 << "s p99 " << stats.throttle.p99 << "s" << endl;
+    }
+
+    if (!deltree.isfinished()) {
+        cout << "stopped before the end, " << (opt.count("nojournal") ? "no journal written" : "progress in " + journal) << endl;
+        return 2;
+    }
+    return ok ? 0 : 1;
+}
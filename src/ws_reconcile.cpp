@@ -0,0 +1,217 @@
+/*
+ *  workspace++
+ *
+ *  ws_reconcile
+ *
+ *  stray check of ws_expirer, only for root or the DB user
+ *
+ *  compares the spaces of a filesystem with its DB and prints one line per directory,
+ *  class and path separated by a tab, with \ tab and newline in paths escaped:
+ *    valid         <space>/<name>
+ *    stray         <space>/<name>               no DB entry, move to deleted
+ *    validremoved  <space>/<deleted>/<name>
+ *    strayremoved  <space>/<deleted>/<name>     no DB entry in DB/deleted, delete
+ *
+ *  with --expire, the DB entries are classified in the same pass, one line per entry with
+ *  class, DB entry, workspace, expiration, released and mailaddress separated by tabs:
+ *    keep, remind, expire     DB/<name>              workspace as in the entry
+ *    restorable, delete       DB/<deleted>/<name>    <space>/<deleted>/<name>, expiration
+ *                                                    is the time of release or expiry
+ *    broken                   DB entry that can not be classified
+ *  time is taken once before the DB is read, released is 0 if not released by the user.
+ *  A last line, next and a time separated by a tab, tells when the next entry not printed as
+ *  due will need the expirer, 0 if none. With --next only that line is printed, the spaces
+ *  are not listed.
+ *  With an up to date DB index, only entries due for expiry, reminder or deletion are read
+ *  and printed, --fullscan reads all and warns about entries that differ from the index.
+ *
+ *  with --memory, listings are sorted with bounded memory through temporary files in --tmpdir
+ *
+ *  exit code 0 if done, 2 if the DB magic is missing (filesystem is skipped),
+ *  3 if a DB entry is broken (needs manual intervention), 1 for other errors
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <boost/program_options.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include "reconcile.h"
+#include "wsconfig.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+/*
+ *  parse the commandline
+ */
+void commandline(po::variables_map &opt, string &filesystem, string &space, size_t &memory, string &tmpdir,
+                 int argc, char**argv) {
+    po::options_description cmd_options( "\nOptions" );
+    cmd_options.add_options()
+            ("help,h", "produce help message")
+            ("version,V", "show version")
+            ("filesystem,F", po::value<string>(&filesystem), "filesystem")
+            ("space,s", po::value<string>(&space), "only this space of the filesystem")
+            ("expire,e", "classify DB entries for expiry and deletion as well")
+            ("next", "only print when the next DB entry is due, do not list spaces")
+            ("fullscan", "read all DB entries, even with an up to date index, and verify the index")
+            ("memory,m", po::value<size_t>(&memory)->default_value(0), "MB per listing in memory, sort the rest in temporary files, 0 is all in memory")
+            ("tmpdir", po::value<string>(&tmpdir), "directory for temporary files, default $TMPDIR or /tmp")
+    ;
+
+    try{
+        po::store(po::command_line_parser(argc, argv).options(cmd_options).run(), opt);
+        po::notify(opt);
+    } catch (...) {
+        cout << "Usage:" << argv[0] << ": [options]" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+
+    if (opt.count("version")) {
+#ifdef IS_GIT_REPOSITORY
+        cout << "workspace build from git commit hash " << GIT_COMMIT_HASH
+             << " on top of release " << WS_VERSION << endl;
+#else
+        cout << "workspace version " << WS_VERSION << endl;
+#endif
+        exit(1);
+    }
+
+    if (opt.count("help") || filesystem == "") {
+        cout << "Usage:" << argv[0] << ": [options]" << endl;
+        cout << "  --filesystem is required" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+}
+
+
+static string escape(const string &s)
+{
+    string r;
+    for (char c : s) {
+        if (c == '\\') r += "\\\\";
+        else if (c == '\t') r += "\\t";
+        else if (c == '\n') r += "\\n";
+        else r += c;
+    }
+    return r;
+}
+
+
+int main(int argc, char **argv) {
+    po::variables_map opt;
+    string filesystem, space, tmpdir;
+    size_t memory;
+    YAML::Node config;
+
+    setenv("LANG","C",1);
+    setenv("LC_CTYPE","C",1);
+    setenv("LC_ALL","C",1);
+    std::setlocale(LC_ALL, "C");
+    std::locale::global(std::locale("C"));
+
+    commandline(opt, filesystem, space, memory, tmpdir, argc, argv);
+
+    try {
+        config = WsConfig::load("/etc/ws.conf");
+    } catch (const YAML::BadFile& e) {
+        cerr << "Error: Could not read config file!" << endl;
+        cerr << e.what() << endl;
+        exit(1);
+    }
+
+    GlobalConfig gconfig(config, YAML::Node());
+
+    if (getuid() != 0 && getuid() != (uid_t)gconfig.dbuid) {
+        cerr << "Error: only root or the DB user can check the DB." << endl;
+        exit(1);
+    }
+
+    if (!gconfig.hasfs(filesystem)) {
+        cerr << "Error: no such filesystem." << endl;
+        exit(1);
+    }
+    const FilesystemConfig &fs = gconfig.getfs(filesystem);
+    if (space != "" && find(fs.spaces.begin(), fs.spaces.end(), space) == fs.spaces.end()) {
+        cerr << "Error: no such space in filesystem." << endl;
+        exit(1);
+    }
+
+    Reconciler reconciler(fs, gconfig.dbuid, gconfig.dbgid);
+    if (memory > 0) {
+        if (tmpdir == "") {
+            tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+        }
+        reconciler.setexternal(memory*1024*1024, tmpdir);
+    }
+    reconciler.setexpire(opt.count("expire") > 0 || opt.count("next") > 0);
+    reconciler.setdbonly(opt.count("next") > 0);
+    reconciler.setfullscan(opt.count("fullscan") > 0);
+    string error;
+    switch (reconciler.scan(space, error)) {
+        case RE_NONE:
+            break;
+        case RE_MAGIC:
+            cerr << "Error: " << error << endl;
+            exit(2);
+        case RE_ENTRY:
+            cerr << "Error: " << error << endl;
+            exit(3);
+        case RE_TMPFILE:
+            cerr << "Error: " << error << endl;
+            exit(1);
+    }
+
+    for (auto const &path : reconciler.getindexdiffs()) {
+        cerr << "Warning: DB entry " << path << " differs from DB index or is missing in it." << endl;
+    }
+
+    if (opt.count("next")) {
+        cout << "next\t" << reconciler.getnextdue() << endl;
+        return cout ? 0 : 1;
+    }
+
+    bool ok = reconciler.classify([](const ReconcileAction &a) {
+        cout << Reconciler::classname(a.what) << "\t" << escape(a.path);
+        if (a.what >= RC_KEEP) {
+            cout << "\t" << escape(a.workspace) << "\t" << a.expiration << "\t" << a.released
+                 << "\t" << escape(a.mailaddress);
+        }
+        cout << "\n";
+    });
+    if (!ok) {
+        cout.flush();
+        cerr << "Error: could not read temporary file in " << tmpdir << endl;
+        exit(1);
+    }
+    if (opt.count("expire")) {
+        cout << "next\t" << reconciler.getnextdue() << "\n";
+    }
+    cout.flush();
+
+    return cout ? 0 : 1;
+}
@@ -46,6 +46,10 @@
 
 
 #include "ws.h"
+#include "wsconfig.h"
+#include "fscred.h"
+#include "wsd.h"
+#include "delspool.h"
 
 namespace po = boost::program_options;
 using namespace std;
@@ -67,6 +71,7 @@ void commandline(po::variables_map &opt, string &name, int &duration,
 				("name,n", po::value<string>(&name), "workspace name")
 				("filesystem,F", po::value<string>(&filesystem), "filesystem")
 				("userworkspace", "release a user workspace")
+				("status", "show progress of all queued deletions")
 		;
 	} else {
 		cmd_options.add_options()
@@ -75,6 +80,7 @@ void commandline(po::variables_map &opt, string &name, int &duration,
 				("name,n", po::value<string>(&name), "workspace name")
 				("filesystem,F", po::value<string>(&filesystem), "filesystem")
 				("delete-data", "delete all data, workspace can NOT BE RECOVERED")
+				("status", "show progress of queued deletions of --delete-data")
 		;
 	}
 
@@ -119,6 +125,10 @@ void commandline(po::variables_map &opt, string &name, int &duration,
         exit(1);
     }
 
+    if (opt.count("status")) {
+        return;
+    }
+
     if (opt.count("name"))
     {
         //cout << " name: " << name << "\n";
@@ -145,10 +155,38 @@ void commandline(po::variables_map &opt, string &name, int &duration,
 
 
 /*
- *  main logic here
+ *  print the queued deletions of the user, of all users for root
  */
+void status(const GlobalConfig &gconfig, const string filesystem)
+{
+    string username = Workspace::getusername();
+    int count = 0;
+    for (auto const &fsconfig : gconfig.getfilesystems()) {
+        if (filesystem != "" && fsconfig.name != filesystem) continue;
+        DelSpool spool(fsconfig.database);
+        for (auto const &ticket : spool.list()) {
+            if (getuid() != 0 && ticket.user != username) continue;
+            DelProgress p = spool.getprogress(ticket.id);
+            time_t queued = ticket.queued;
+            string when = ctime(&queued);
+            cout << ticket.id << " in " << fsconfig.name << ": " << p.state << ", " << p.files << " files, "
+                 << p.dirs << " directories, " << p.bytes << " bytes removed";
+            if (p.errors > 0) cout << ", " << p.errors << " errors";
+            cout << ", queued " << when;
+            count++;
+        }
+    }
+    if (count == 0) {
+        cout << "no queued deletions" << endl;
+    }
+}
 
-int main(int argc, char **argv) {
+
+/*
+ *  main logic here, called by main() or by wsd
+ */
+
+int ws_release(int argc, char **argv) {
     int duration=0;
     bool extensionflag;
     string name;
@@ -168,16 +206,18 @@ int main(int argc, char **argv) {
 	
     // read config
     try {
-        config = YAML::LoadFile("/etc/ws.conf");
+        config = WsConfig::load("/etc/ws.conf");
     } catch (const YAML::BadFile& e) {
         cerr << "Error: Could not read config file!" << endl;
         cerr << e.what() << endl;
         exit(-1);
     }
 
-    int db_uid = config["dbuid"].as<int>();
+    GlobalConfig gconfig(config, YAML::Node());
+    int db_uid = gconfig.dbuid;
 
-    // lower capabilities to minimum
+    // lower capabilities to minimum, threads can still act as DB group
+    FsCred::keepgid(gconfig.dbgid);
     Workspace::drop_cap(CAP_DAC_OVERRIDE, CAP_CHOWN, CAP_FOWNER, db_uid, __LINE__, __FILE__);
 
     // check commandline
@@ -185,12 +225,29 @@ int main(int argc, char **argv) {
 
     openlog("ws_release", 0, LOG_USER); // SYSLOG
 
+    if (opt.count("status")) {
+        status(gconfig, filesystem);
+        return 0;
+    }
+
     // get workspace object
     Workspace ws(WS_Release, opt, duration, filesystem);
     
     // release workspace
     ws.release(name);
-    
+    if (opt.count("debug")) {
+        Workspace::print_capstats();
+        Workspace::print_pathstats();
+    }
+
+    return 0;
 }
 
+#ifndef WSD
+int main(int argc, char **argv) {
+    // wsd does the work if it runs
+    WsdClient::delegate("ws_release", argc, argv);
 
+    return ws_release(argc, argv);
+}
+#endif
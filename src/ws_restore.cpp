@@ -63,6 +63,9 @@
 
 
 #include "ws.h"
+#include "wsconfig.h"
+#include "fscred.h"
+#include "nsscache.h"
 #include "ruh.h"
 
 namespace fs = boost::filesystem;
@@ -188,104 +191,55 @@ bool check_name(const string name, const string username, const string real_user
 
 
 // get list of valid filesystems for current user
-std::vector<string> get_valid_fslist() {
+std::vector<string> get_valid_fslist(const GlobalConfig &config) {
   vector<string> fslist;
 
-  YAML::Node config;
-  // read config
-  try {
-      config = YAML::LoadFile("/etc/ws.conf");
-  } catch (const YAML::BadFile& e) {
-      cerr << "Error: Could not read config file!" << endl;
-      cerr << e.what() << endl;
-      exit(-1);
-  }
-
   // get user name, group names etc
   vector<string> groupnames;
 
   string username = Workspace::getusername(); // FIXME is this correct? what if username given on commandline?
 
-  struct group *grp;
-  int ngroups = 128;
-  gid_t gids[128];
-  int nrgroups;
-  string primarygroup;
-
-  nrgroups = getgrouplist(username.c_str(), geteuid(), gids, &ngroups);
-  if(nrgroups<=0) {
-      cerr << "Error: user in too many groups!" << endl;
-  }
-  for(int i=0; i<nrgroups; i++) {
-      grp=getgrgid(gids[i]);
-      if(grp) groupnames.push_back(string(grp->gr_name));
+  for(auto const &grp: NssCache::getgroups(username, getgid())) {
+      if(grp.name != "") groupnames.push_back(grp.name);
   }
   // get current group
-  grp=getgrgid(getegid());
-  if(grp==NULL) {
+  string primarygroup = NssCache::getgroupname(getgid());
+  if(primarygroup == "") {
       cerr << "Error: user has no group anymore!" << endl;
       exit(-1);
   }
-  primarygroup=string(grp->gr_name);
 
   // iterate over all filesystems and search the ones allowed for current user
-  YAML::Node node = config["workspaces"];
-  for(YAML::const_iterator it = node.begin(); it!=node.end(); ++it ) {
-      std::string cfilesystem = it->first.as<std::string>();
-      // check ACLs
-      vector<string>user_acl;
-      vector<string>group_acl;
-
-      // read ACL lists
-      if ( config["workspaces"][cfilesystem]["user_acl"]) {
-          for(string v: config["workspaces"][cfilesystem]["user_acl"].as<vector<string> >())
-              user_acl.push_back(v);
-      }
-      if ( config["workspaces"][cfilesystem]["group_acl"]) {
-          for(string v: config["workspaces"][cfilesystem]["group_acl"].as<vector<string> >())
-              group_acl.push_back(v);
-      }
-
+  for(auto const &fsconfig: config.getfilesystems()) {
       // check ACLs
       bool userok=true;
-      if(user_acl.size()>0 || group_acl.size()>0) userok=false;
+      if(fsconfig.hasacl()) userok=false;
 
-      if( find(group_acl.begin(), group_acl.end(), primarygroup) != group_acl.end() ) {
+      if( fsconfig.ingroupacl(primarygroup) ) {
           userok=true;
       }
 #ifdef CHECK_ALL_GROUPS
       for(string grp: groupnames) {
-          if( find(group_acl.begin(), group_acl.end(), grp) != group_acl.end() ) {
+          if( fsconfig.ingroupacl(grp) ) {
               userok=true;
               break;
           }
       }
 #endif
-      if( find(user_acl.begin(), user_acl.end(), username) != user_acl.end() ) {
+      if( fsconfig.inuseracl(username) ) {
           userok=true;
       }
       if(userok || getuid()==0) {
-          fslist.push_back(cfilesystem);
+          fslist.push_back(fsconfig.name);
       }
   }
   return fslist;
 }
 
 // get restorable workspaces as names
-vector<string> getRestorable(string filesystem, string username)
+vector<string> getRestorable(const GlobalConfig &config, string filesystem, string username)
 {
-    YAML::Node config;
-    // read config
-    try {
-        config = YAML::LoadFile("/etc/ws.conf");
-    } catch (const YAML::BadFile& e) {
-        cerr << "Error: Could not read config file!" << endl;
-        cerr << e.what() << endl;
-        exit(-1);
-    }
-
-    string dbprefix = config["workspaces"][filesystem]["database"].as<string>() + "/" +
-                      config["workspaces"][filesystem]["deleted"].as<string>();
+    string dbprefix = config.getfs(filesystem).database + "/" + config.getfs(filesystem).deleted;
 
     vector<string> namelist;
 
@@ -331,16 +285,20 @@ int main(int argc, char **argv) {
 
     // read config
     try {
-        config = YAML::LoadFile("/etc/ws.conf");
+        config = WsConfig::load("/etc/ws.conf");
     } catch (const YAML::BadFile& e) {
         cerr << "Error: Could not read config file!" << endl;
         cerr << e.what() << endl;
         exit(-1);
     }
 
-    int db_uid = config["dbuid"].as<int>();
+    // ws_private.conf is not needed for listing
+    GlobalConfig gconfig(config, YAML::Node());
+    int db_uid = gconfig.dbuid;
+    NssCache::setup(gconfig.nsscache, gconfig.nsscache_ttl, db_uid);
 
-    // lower capabilities to minimum
+    // lower capabilities to minimum, threads can still act as DB group
+    FsCred::keepgid(gconfig.dbgid);
     Workspace::drop_cap(CAP_DAC_OVERRIDE, CAP_DAC_READ_SEARCH, db_uid);
 
 
@@ -352,7 +310,7 @@ int main(int argc, char **argv) {
     if (listflag) {
 
         vector<string> fslist;
-        auto validfs = get_valid_fslist();
+        auto validfs = get_valid_fslist(gconfig);
 
         if (filesystem.size() > 0) {
             if (canFind(validfs, filesystem)) fslist.push_back(filesystem);
@@ -374,7 +332,7 @@ int main(int argc, char **argv) {
                     exit(-1);
                 }
             }
-            for(string dn: getRestorable(fs, username)) {
+            for(string dn: getRestorable(gconfig, fs, username)) {
                 cout << dn << endl;
                 if (!terse) {
                     std::vector<std::string> splitted;
@@ -404,6 +362,10 @@ int main(int argc, char **argv) {
         if (check_name(name, username, real_username)) {
             if (ruh()) {
                 ws.restore(name, target, username);
+                if (opt.count("debug")) {
+                    Workspace::print_capstats();
+                    Workspace::print_pathstats();
+                }
             } else {
                 syslog(LOG_INFO, "user <%s> failed ruh test.", username.c_str());
             }
@@ -0,0 +1,473 @@
+/*
+ *  workspace++
+ *
+ *  loading of the configuration files, with precompiled snapshots
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#include <stdlib.h>
+#include <string.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wsconfig.h"
+
+using namespace std;
+
+static_assert(sizeof(WsConfigHeader) == 64, "config header has to be 64 bytes");
+static_assert(sizeof(WsConfigNode) == 16, "config node has to be 16 bytes");
+
+static const char MAGIC[8] = { 'W', 'S', 'C', 'O', 'N', 'F', 0, 0 };
+
+// configs already read in this process
+static map<string, YAML::Node> cache;
+static set<string> snapshots;
+
+
+/*
+ * read whole file and compute FNV-1a hash, returns false if file can not be read
+ */
+static bool hashfile(int fd, uint64_t &hash, string *content)
+{
+    hash = 14695981039346656037ULL;
+    char buf[16384];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            hash ^= (unsigned char)buf[i];
+            hash *= 1099511628211ULL;
+        }
+        if (content) content->append(buf, n);
+    }
+    return n == 0;
+}
+
+
+/*
+ * rebuild node tree from flat preorder list
+ */
+static YAML::Node buildnode(const WsConfigNode *nodes, uint32_t count, const char *strings, uint64_t stringsize,
+                            uint32_t &pos, bool &ok)
+{
+    if (pos >= count) {
+        ok = false;
+        return YAML::Node();
+    }
+    const WsConfigNode &n = nodes[pos++];
+    switch (n.type) {
+        case YAML::NodeType::Scalar: {
+            if ((uint64_t)n.str_off + n.str_len > stringsize) {
+                ok = false;
+                return YAML::Node();
+            }
+            return YAML::Node(string(strings + n.str_off, n.str_len));
+        }
+        case YAML::NodeType::Sequence: {
+            YAML::Node node(YAML::NodeType::Sequence);
+            for (uint32_t i = 0; i < n.children && ok; i++) {
+                node.push_back(buildnode(nodes, count, strings, stringsize, pos, ok));
+            }
+            return node;
+        }
+        case YAML::NodeType::Map: {
+            YAML::Node node(YAML::NodeType::Map);
+            for (uint32_t i = 0; i < n.children && ok; i++) {
+                YAML::Node key = buildnode(nodes, count, strings, stringsize, pos, ok);
+                YAML::Node value = buildnode(nodes, count, strings, stringsize, pos, ok);
+                if (!ok) break;
+                // scalar keys as strings, so lookups compare by value
+                if (key.IsScalar()) {
+                    node[key.Scalar()] = value;
+                } else {
+                    node[key] = value;
+                }
+            }
+            return node;
+        }
+        case YAML::NodeType::Null:
+            return YAML::Node(YAML::NodeType::Null);
+        default:
+            ok = false;
+            return YAML::Node();
+    }
+}
+
+
+/*
+ * try to read snapshot of filename, false if there is none or it does not match the source
+ */
+bool WsConfig::readsnapshot(const string filename, YAML::Node &node)
+{
+    int sfd = open(filename.c_str(), O_RDONLY|O_CLOEXEC);
+    if (sfd < 0) return false;
+    int fd = open(snapshotname(filename).c_str(), O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) {
+        close(sfd);
+        return false;
+    }
+
+    struct stat sst, st;
+    bool ok = fstat(sfd, &sst) == 0 && fstat(fd, &st) == 0;
+    // only root may provide a snapshot, as it replaces the config
+    if (ok && (st.st_uid != 0 || (st.st_mode & (S_IWGRP|S_IWOTH)) || !S_ISREG(st.st_mode) ||
+               st.st_size < (off_t)sizeof(WsConfigHeader))) {
+        ok = false;
+    }
+    void *map = MAP_FAILED;
+    if (ok) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) ok = false;
+    }
+    close(fd);
+    if (!ok) {
+        close(sfd);
+        return false;
+    }
+
+    const char *base = (const char *)map;
+    const WsConfigHeader *h = (const WsConfigHeader *)base;
+    ok = memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == WSCONFIG_VERSION &&
+         h->mtime_sec == sst.st_mtim.tv_sec && h->mtime_nsec == sst.st_mtim.tv_nsec &&
+         h->size == (uint64_t)sst.st_size &&
+         sizeof(WsConfigHeader) + (uint64_t)h->nodes * sizeof(WsConfigNode) + h->stringsize <= (uint64_t)st.st_size;
+    if (ok) {
+        // mtime could be faked, the content has to match as well
+        uint64_t hash;
+        ok = hashfile(sfd, hash, NULL) && hash == h->hash;
+    }
+    close(sfd);
+    if (ok) {
+        const WsConfigNode *nodes = (const WsConfigNode *)(base + sizeof(WsConfigHeader));
+        const char *strings = base + sizeof(WsConfigHeader) + h->nodes * sizeof(WsConfigNode);
+        uint32_t pos = 0;
+        node = buildnode(nodes, h->nodes, strings, h->stringsize, pos, ok);
+        if (pos != h->nodes) ok = false;
+    }
+    munmap(map, st.st_size);
+    return ok;
+}
+
+
+YAML::Node WsConfig::load(const string filename)
+{
+    auto it = cache.find(filename);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    YAML::Node node;
+    if (readsnapshot(filename, node)) {
+        snapshots.insert(filename);
+    } else {
+        node = YAML::LoadFile(filename);
+    }
+    cache[filename] = node;
+    return node;
+}
+
+void WsConfig::forget()
+{
+    cache.clear();
+    snapshots.clear();
+}
+
+bool WsConfig::fromsnapshot(const string filename)
+{
+    return snapshots.count(filename) > 0;
+}
+
+
+/*
+ * flatten node tree in preorder
+ */
+static void flatten(const YAML::Node &node, vector<WsConfigNode> &nodes, string &strings)
+{
+    WsConfigNode n;
+    memset(&n, 0, sizeof(n));
+    n.type = node.Type();
+    switch (node.Type()) {
+        case YAML::NodeType::Scalar:
+            n.str_off = strings.size();
+            n.str_len = node.Scalar().size();
+            strings += node.Scalar();
+            nodes.push_back(n);
+            break;
+        case YAML::NodeType::Sequence:
+            n.children = node.size();
+            nodes.push_back(n);
+            for (auto const &child : node) {
+                flatten(child, nodes, strings);
+            }
+            break;
+        case YAML::NodeType::Map:
+            n.children = node.size();
+            nodes.push_back(n);
+            for (auto const &child : node) {
+                flatten(child.first, nodes, strings);
+                flatten(child.second, nodes, strings);
+            }
+            break;
+        default:
+            n.type = YAML::NodeType::Null;
+            nodes.push_back(n);
+            break;
+    }
+}
+
+
+bool WsConfig::compile(const string filename, string &error)
+{
+    int sfd = open(filename.c_str(), O_RDONLY|O_CLOEXEC);
+    if (sfd < 0) {
+        error = string("can not open ") + filename + ": " + strerror(errno);
+        return false;
+    }
+    struct stat sst;
+    string content;
+    WsConfigHeader h;
+    memset(&h, 0, sizeof(h));
+    if (fstat(sfd, &sst) != 0 || !hashfile(sfd, h.hash, &content)) {
+        error = string("can not read ") + filename + ": " + strerror(errno);
+        close(sfd);
+        return false;
+    }
+    close(sfd);
+
+    // hash and tree are taken from the same content
+    YAML::Node root;
+    try {
+        root = YAML::Load(content);
+    } catch (const YAML::Exception &e) {
+        error = string("invalid YAML in ") + filename + ": " + e.what();
+        return false;
+    }
+
+    vector<WsConfigNode> nodes;
+    string strings;
+    flatten(root, nodes, strings);
+
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = WSCONFIG_VERSION;
+    h.nodes = nodes.size();
+    h.stringsize = strings.size();
+    h.mtime_sec = sst.st_mtim.tv_sec;
+    h.mtime_nsec = sst.st_mtim.tv_nsec;
+    h.size = sst.st_size;
+
+    // snapshot gets the permissions of the source, ws_private.conf has to stay private
+    string target = snapshotname(filename);
+    string tmpname = target + ".tmp";
+    unlink(tmpname.c_str());
+    int fd = open(tmpname.c_str(), O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC|O_NOFOLLOW, 0600);
+    if (fd < 0) {
+        error = string("can not create ") + tmpname + ": " + strerror(errno);
+        return false;
+    }
+    bool ok = write(fd, &h, sizeof(h)) == sizeof(h);
+    size_t nsize = nodes.size() * sizeof(WsConfigNode);
+    if (ok && nsize > 0) ok = write(fd, nodes.data(), nsize) == (ssize_t)nsize;
+    if (ok && strings.size() > 0) ok = write(fd, strings.data(), strings.size()) == (ssize_t)strings.size();
+    if (ok) ok = fchmod(fd, sst.st_mode & 0644) == 0;
+    if (ok) ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    if (!ok || rename(tmpname.c_str(), target.c_str()) != 0) {
+        error = string("can not write ") + target + ": " + strerror(errno);
+        unlink(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+int FilesystemConfig::getduration(const string &user) const
+{
+    auto it = userexceptions.find(user);
+    if (it != userexceptions.end() && it->second.duration >= 0) {
+        return it->second.duration;
+    }
+    if (duration < 0) {
+        cerr << "Error: no duration configured for workspace <" << name << ">!" << endl;
+        exit(-1);
+    }
+    return duration;
+}
+
+int FilesystemConfig::getmaxextensions(const string &user) const
+{
+    auto it = userexceptions.find(user);
+    if (it != userexceptions.end() && it->second.maxextensions >= 0) {
+        return it->second.maxextensions;
+    }
+    if (maxextensions < 0) {
+        cerr << "Error: no maxextensions configured for workspace <" << name << ">!" << endl;
+        exit(-1);
+    }
+    return maxextensions;
+}
+
+
+/*
+ * list valued setting, missing or null are an empty list
+ */
+static vector<string> getlist(const YAML::Node &node)
+{
+    if (node && node.IsSequence()) {
+        return node.as<vector<string> >();
+    }
+    return vector<string>();
+}
+
+/*
+ * value of key in map, without creating invalid nodes for missing keys
+ */
+static YAML::Node findmap(const YAML::Node &node, const char *key)
+{
+    if (node.IsMap()) {
+        for (YAML::const_iterator it = node.begin(); it != node.end(); ++it) {
+            if (it->first.IsScalar() && it->first.Scalar() == key) return it->second;
+        }
+    }
+    return YAML::Node();
+}
+
+GlobalConfig::GlobalConfig(const YAML::Node &config, const YAML::Node &userconfig)
+{
+    try {
+        if (!config["dbuid"] || !config["dbgid"]) {
+            cerr << "Error: no dbuid or dbgid in config!" << endl;
+            exit(-1);
+        }
+        dbuid = config["dbuid"].as<int>();
+        dbgid = config["dbgid"].as<int>();
+        defaultfs = config["default"] ? config["default"].as<string>() : "";
+        reminderdefault = config["reminderdefault"].as<int>(0);
+        durationdefault = config["durationdefault"].as<int>(1);
+        nsscache = config["nsscache"].as<string>("");
+        nsscache_ttl = config["nsscache_ttl"].as<int>(300);
+        spacecache = config["spacecache"].as<string>("");
+        spacecache_maxage = config["spacecache_maxage"].as<int>(60);
+
+        int duration = config["duration"].as<int>(-1);
+        int maxextensions = config["maxextensions"].as<int>(-1);
+        int deldir_threads = config["deldir_threads"].as<int>(4);
+        double deldir_rate = config["deldir_rate"].as<double>(0);
+        double deldir_latency = config["deldir_latency"].as<double>(0);
+        int mv_threads = config["mv_threads"].as<int>(4);
+        double dbprobe_timeout = config["dbprobe_timeout"].as<double>(10);
+        double statfs_timeout = config["statfs_timeout"].as<double>(5);
+        double highwatermark = config["highwatermark"].as<double>(0);
+        int pool_size = config["pool_size"].as<int>(0);
+
+        YAML::Node node = config["workspaces"];
+        for (YAML::const_iterator it = node.begin(); it != node.end(); ++it) {
+            const YAML::Node &ws = it->second;
+            FilesystemConfig fs;
+            fs.name = it->first.as<string>();
+            fs.database = ws["database"].as<string>("");
+            fs.deleted = ws["deleted"].as<string>("");
+            fs.spaces = getlist(ws["spaces"]);
+            fs.spaceselection = ws["spaceselection"].as<string>("random");
+            fs.spaceweights.assign(fs.spaces.size(), 1.0);
+            vector<string> weights = getlist(ws["spaceweights"]);
+            for (size_t i = 0; i < weights.size() && i < fs.spaces.size(); i++) {
+                fs.spaceweights[i] = atof(weights[i].c_str());
+            }
+            fs.highwatermark = ws["highwatermark"].as<double>(highwatermark);
+            fs.prefix_callout = ws["prefix_callout"].as<string>("");
+            fs.duration = ws["duration"].as<int>(duration);
+            fs.maxextensions = ws["maxextensions"].as<int>(maxextensions);
+            fs.keeptime = ws["keeptime"].as<int>(-1);
+            fs.allocatable = ws["allocatable"].as<bool>(true);
+            fs.extendable = ws["extendable"].as<bool>(true);
+            fs.restorable = ws["restorable"].as<bool>(true);
+            for (auto const &u : getlist(ws["user_acl"])) fs.user_acl.insert(u);
+            for (auto const &g : getlist(ws["group_acl"])) fs.group_acl.insert(g);
+            fs.userdefault = getlist(ws["userdefault"]);
+            fs.groupdefault = getlist(ws["groupdefault"]);
+            fs.deldir_threads = ws["deldir_threads"].as<int>(deldir_threads);
+            fs.deldir_rate = ws["deldir_rate"].as<double>(deldir_rate);
+            fs.deldir_latency = ws["deldir_latency"].as<double>(deldir_latency);
+            fs.mv_threads = ws["mv_threads"].as<int>(mv_threads);
+            fs.dbprobe_timeout = ws["dbprobe_timeout"].as<double>(dbprobe_timeout);
+            fs.statfs_timeout = ws["statfs_timeout"].as<double>(statfs_timeout);
+            fs.pool_size = ws["pool_size"].as<int>(pool_size);
+
+            YAML::Node exceptions = findmap(findmap(userconfig, "workspaces"), fs.name.c_str());
+            exceptions = findmap(exceptions, "userexceptions");
+            if (exceptions.IsMap()) {
+                for (YAML::const_iterator ue = exceptions.begin(); ue != exceptions.end(); ++ue) {
+                    UserException e;
+                    e.duration = ue->second["duration"].as<int>(-1);
+                    e.maxextensions = ue->second["maxextensions"].as<int>(-1);
+                    fs.userexceptions[ue->first.as<string>()] = e;
+                }
+            }
+
+            for (auto const &u : fs.userdefault) {
+                userdefaults[u] = fs.name;
+                if (fs.allocatable) userdefaults_alloc[u] = fs.name;
+            }
+            for (auto const &g : fs.groupdefault) {
+                groupdefaults[g] = fs.name;
+                if (fs.allocatable) groupdefaults_alloc[g] = fs.name;
+            }
+
+            byname[fs.name] = filesystems.size();
+            filesystems.push_back(fs);
+        }
+    } catch (const YAML::Exception &e) {
+        cerr << "Error: invalid config: " << e.what() << endl;
+        exit(-1);
+    }
+}
+
+const FilesystemConfig &GlobalConfig::getfs(const string &name) const
+{
+    auto it = byname.find(name);
+    if (it == byname.end()) {
+        cerr << "Error: workspace <" << name << "> is not configured!" << endl;
+        exit(-1);
+    }
+    return filesystems[it->second];
+}
+
+string GlobalConfig::userdefault(const string &user, const bool allocatableonly) const
+{
+    const unordered_map<string, string> &m = allocatableonly ? userdefaults_alloc : userdefaults;
+    auto it = m.find(user);
+    return it == m.end() ? "" : it->second;
+}
+
+string GlobalConfig::groupdefault(const string &group, const bool allocatableonly) const
+{
+    const unordered_map<string, string> &m = allocatableonly ? groupdefaults_alloc : groupdefaults;
+    auto it = m.find(group);
+    return it == m.end() ? "" : it->second;
+}
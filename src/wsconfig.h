@@ -0,0 +1,176 @@
+#ifndef WSCONFIG_H
+#define WSCONFIG_H
+
+/*
+ *  workspace++
+ *
+ *  loading of the configuration files, with precompiled snapshots
+ *
+ *  ws_compile_config writes next to a YAML config file (e.g. /etc/ws.conf) a snapshot
+ *  (/etc/ws.conf.bin) containing the parsed node tree in a flat binary form, which can be
+ *  turned into YAML nodes without running the YAML parser. A snapshot is only used if it
+ *  is owned by root, not writable by group or others, and if mtime, size and FNV-1a hash
+ *  of the source file still match, otherwise the YAML file is parsed as before.
+ *
+ *  layout (native byte order):
+ *    header  64 bytes:  magic "WSCONF\0\0", version, number of nodes, size of strings,
+ *                       mtime (sec, nsec), size and hash of source file
+ *    nodes   16 bytes each, in preorder: type, number of children (map: pairs),
+ *                       offset and length of scalar in string table
+ *    strings
+ *
+ *  GlobalConfig and FilesystemConfig hold the parsed configuration in typed form, with the
+ *  fallbacks from ws_private.conf to workspace to global values resolved once at startup.
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+
+#include <yaml-cpp/yaml.h>
+
+using namespace std;
+
+const uint32_t WSCONFIG_VERSION = 1;
+
+struct WsConfigHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodes;
+    uint64_t stringsize;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t size;
+    uint64_t hash;
+    uint64_t reserved;
+};
+
+struct WsConfigNode {
+    uint32_t type;          // YAML::NodeType
+    uint32_t children;      // elements of sequence, pairs of map
+    uint32_t str_off;
+    uint32_t str_len;
+};
+
+
+// limits of a single user from ws_private.conf, -1 if not given
+struct UserException {
+    int duration;
+    int maxextensions;
+};
+
+// settings of one filesystem, with global values and defaults already filled in
+struct FilesystemConfig {
+    string name;
+    string database;
+    string deleted;
+    vector<string> spaces;
+    vector<double> spaceweights;    // one per space, 0 takes a space out of placement
+    string spaceselection;      // placement policy, see placement.h
+    double highwatermark;       // percent of bytes or inodes used to exclude a space, 0 if none
+    string prefix_callout;      // empty if none
+    int duration;               // -1 if neither workspace nor global value exists
+    int maxextensions;          // -1 if neither workspace nor global value exists
+    int keeptime;
+    bool allocatable, extendable, restorable;
+    unordered_set<string> user_acl, group_acl;
+    vector<string> userdefault, groupdefault;
+    int deldir_threads;
+    double deldir_rate;
+    double deldir_latency;      // target latency of a metadata operation in seconds, 0 if fixed rate
+    int mv_threads;
+    double dbprobe_timeout;     // seconds to wait for DB, 0 waits forever
+    double statfs_timeout;      // seconds to wait for statfs of spaces, 0 waits forever
+    int pool_size;              // precreated directories per space kept by ws_expirer, 0 if none
+    unordered_map<string, UserException> userexceptions;
+
+    // empty ACLs mean everybody may use the filesystem
+    bool hasacl() const { return !user_acl.empty() || !group_acl.empty(); }
+    bool inuseracl(const string &user) const { return user_acl.count(user) > 0; }
+    bool ingroupacl(const string &group) const { return group_acl.count(group) > 0; }
+
+    // limits for user, userexception in workspace/workspace/global, exits if none is configured
+    int getduration(const string &user) const;
+    int getmaxextensions(const string &user) const;
+};
+
+// whole configuration, parsed once from ws.conf and ws_private.conf
+class GlobalConfig {
+private:
+    vector<FilesystemConfig> filesystems;              // in order of the config file
+    unordered_map<string, size_t> byname;
+    // defaults of all filesystems and of allocatable filesystems only,
+    // a later filesystem overrides an earlier one like in the config file
+    unordered_map<string, string> userdefaults, groupdefaults;
+    unordered_map<string, string> userdefaults_alloc, groupdefaults_alloc;
+
+public:
+    int dbuid, dbgid;
+    string defaultfs;           // empty if none
+    int reminderdefault, durationdefault;
+    string nsscache;            // directory of group lookup cache, empty if none
+    int nsscache_ttl;
+    string spacecache;          // directory of free space samples, empty if none
+    int spacecache_maxage;
+
+    GlobalConfig() : dbuid(-1), dbgid(-1), reminderdefault(0), durationdefault(1), nsscache_ttl(300), spacecache_maxage(60) {};
+    // exits with an error message if the config is not usable
+    GlobalConfig(const YAML::Node &config, const YAML::Node &userconfig);
+
+    const vector<FilesystemConfig> &getfilesystems() const { return filesystems; }
+    bool hasfs(const string &name) const { return byname.count(name) > 0; }
+    // exits with an error message for unknown filesystems
+    const FilesystemConfig &getfs(const string &name) const;
+
+    // default filesystem for user or group, empty if none
+    string userdefault(const string &user, const bool allocatableonly) const;
+    string groupdefault(const string &group, const bool allocatableonly) const;
+};
+
+
+class WsConfig {
+
+private:
+    static bool readsnapshot(const string filename, YAML::Node &node);
+
+public:
+    // load a config file, from snapshot if valid, from YAML otherwise,
+    // throws YAML::BadFile like YAML::LoadFile, each file is read only once per process
+    static YAML::Node load(const string filename);
+
+    // drop all files loaded so far, the next load() reads them again
+    static void forget();
+
+    // parse filename and write snapshot filename.bin, returns false and sets error on failure
+    static bool compile(const string filename, string &error);
+
+    // name of snapshot of filename
+    static string snapshotname(const string filename) {
+        return filename + ".bin";
+    }
+
+    // true if last load() of filename was served from snapshot
+    static bool fromsnapshot(const string filename);
+};
+
+#endif
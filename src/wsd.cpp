@@ -0,0 +1,447 @@
+/*
+ *  workspace++
+ *
+ *  wsd, optional daemon serving ws_allocate and ws_release, see wsd.h
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#ifndef SETUID
+#include <sys/capability.h>
+#include <sys/prctl.h>
+#endif
+
+#include <yaml-cpp/yaml.h>
+#include <boost/program_options.hpp>
+
+#include "ws.h"
+#include "wsconfig.h"
+#include "nsscache.h"
+#include "wsd.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+/*
+ * the programs served
+ */
+struct Program {
+    const char *name;
+    int (*run)(int argc, char **argv);
+};
+
+static const Program programs[] = {
+    {"ws_allocate", ws_allocate},
+    {"ws_release", ws_release},
+};
+
+static const char *configfiles[] = {"/etc/ws.conf", "/etc/ws_private.conf"};
+
+static int listenfd = -1;
+static int sigpipe[2] = {-1, -1};
+static volatile sig_atomic_t stopping = 0;
+
+
+static void onsignal(int sig)
+{
+    int saved = errno;
+    if (sig != SIGCHLD) stopping = 1;
+    char c = 0;
+    if (write(sigpipe[1], &c, 1) < 0) {
+        // pipe full, the loop wakes up anyway
+    }
+    errno = saved;
+}
+
+
+/*
+ * modification times and sizes of the config files and their snapshots,
+ * a change means the config has to be loaded again
+ */
+static string configstamp()
+{
+    string stamp;
+    for (auto name : configfiles) {
+        for (auto const &filename : {string(name), WsConfig::snapshotname(name)}) {
+            struct stat st;
+            if (stat(filename.c_str(), &st) == 0) {
+                stamp += to_string(st.st_ino) + ":" + to_string(st.st_mtim.tv_sec) + "." +
+                         to_string(st.st_mtim.tv_nsec) + ":" + to_string(st.st_size);
+            }
+            stamp += " ";
+        }
+    }
+    return stamp;
+}
+
+/*
+ * load the config into the memory the children get, false if ws.conf can not be read,
+ * the children report that then
+ */
+static bool loadconfig()
+{
+    WsConfig::forget();
+    YAML::Node config, privateconfig;
+    try {
+        config = WsConfig::load(configfiles[0]);
+    } catch (const YAML::Exception &e) {
+        syslog(LOG_ERR, "can not read %s: %s", configfiles[0], e.what());
+        return false;
+    }
+    try {
+        privateconfig = WsConfig::load(configfiles[1]);
+    } catch (const YAML::Exception &) {
+        // optional
+    }
+    try {
+        GlobalConfig gconfig(config, privateconfig);
+        NssCache::setup(gconfig.nsscache, gconfig.nsscache_ttl, gconfig.dbuid);
+    } catch (const YAML::Exception &e) {
+        syslog(LOG_ERR, "bad config %s: %s", configfiles[0], e.what());
+        return false;
+    }
+    return true;
+}
+
+
+static bool readall(int fd, void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/*
+ * read the request and the terminal of the client, false if it is broken
+ */
+static bool readrequest(int conn, vector<string> &strings)
+{
+    uint32_t length;
+    struct iovec iov;
+    iov.iov_base = &length;
+    iov.iov_len = sizeof(length);
+    union {
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t n;
+    do {
+        n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+
+    vector<int> fds;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                fds.push_back(fd);
+            }
+        }
+    }
+    if (fds.size() != 3 || (msg.msg_flags & MSG_CTRUNC)) return false;
+    for (int i = 0; i < 3; i++) {
+        if (dup2(fds[i], i) < 0) return false;
+        close(fds[i]);
+    }
+
+    if (n < (ssize_t)sizeof(length) && !readall(conn, (char *)&length + n, sizeof(length) - n)) return false;
+    if (length == 0 || length > WSD_MAXREQUEST) return false;
+    string request(length, '\0');
+    if (!readall(conn, &request[0], length) || request[length - 1] != '\0') return false;
+
+    strings.clear();
+    for (size_t pos = 0; pos < length; pos = request.find('\0', pos) + 1) {
+        strings.push_back(request.c_str() + pos);
+    }
+    return strings.size() >= 3 && strings[0] == WSD_MAGIC;
+}
+
+/*
+ * take the credentials the binary of the client would have, the groups are looked up here,
+ * a slow NSS only holds up this request
+ */
+static void becomeclient(const struct ucred &cred)
+{
+    vector<gid_t> groups;
+    struct passwd *pw = getpwuid(cred.uid);
+    if (pw) {
+        for (auto const &g : NssCache::getgroups(pw->pw_name, cred.gid)) {
+            groups.push_back(g.gid);
+        }
+    } else {
+        groups.push_back(cred.gid);
+    }
+    if (setgroups(groups.size(), groups.data()) != 0 || setresgid(cred.gid, cred.gid, cred.gid) != 0) {
+        cerr << "Error: wsd can not change gid." << endl;
+        exit(1);
+    }
+#ifdef SETUID
+    // like the setuid binary: real uid of the user, root as effective and saved uid
+    if (setresuid(cred.uid, 0, 0) != 0) {
+        cerr << "Error: wsd can not change uid." << endl;
+        exit(1);
+    }
+#else
+    // like the binary with file capabilities: the user, with the capabilities permitted
+    cap_value_t cap_list[] = {CAP_DAC_OVERRIDE, CAP_CHOWN, CAP_FOWNER};
+    cap_t caps = cap_init();
+    if (prctl(PR_SET_KEEPCAPS, 1) != 0 || setresuid(cred.uid, cred.uid, cred.uid) != 0 ||
+        cap_set_flag(caps, CAP_PERMITTED, 3, cap_list, CAP_SET) != 0 || cap_set_proc(caps) != 0) {
+        cerr << "Error: wsd can not change uid." << endl;
+        exit(1);
+    }
+    cap_free(caps);
+    prctl(PR_SET_KEEPCAPS, 0);
+#endif
+}
+
+/*
+ * child for one request, never returns
+ */
+static void serve(int conn, const struct ucred &cred)
+{
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    close(listenfd);
+    close(sigpipe[0]);
+    close(sigpipe[1]);
+
+    // a client which does not send its request does not keep the child for long
+    struct timeval timeout = {10, 0};
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    vector<string> strings;
+    if (!readrequest(conn, strings)) {
+        syslog(LOG_WARNING, "broken request of uid %d", (int)cred.uid);
+        _exit(1);
+    }
+    close(conn);
+
+    const Program *program = NULL;
+    for (auto const &p : programs) {
+        if (strings[1] == p.name) program = &p;
+    }
+    if (!program) {
+        cerr << "Error: wsd does not serve " << strings[1] << "." << endl;
+        exit(1);
+    }
+
+    becomeclient(cred);
+
+    vector<char *> argv;
+    for (size_t i = 2; i < strings.size(); i++) {
+        argv.push_back(&strings[i][0]);
+    }
+    int argc = argv.size();
+    argv.push_back(NULL);
+    exit(program->run(argc, argv.data()));
+}
+
+
+int main(int argc, char **argv)
+{
+    string socketname;
+    int maxchildren;
+    po::variables_map opt;
+
+    po::options_description cmd_options("\nOptions");
+    cmd_options.add_options()
+        ("help,h", "produce help message")
+        ("socket,s", po::value<string>(&socketname)->default_value(WSD_SOCKET), "socket to listen on")
+        ("max-requests,m", po::value<int>(&maxchildren)->default_value(64), "requests served at the same time")
+        ;
+    try {
+        po::store(po::parse_command_line(argc, argv, cmd_options), opt);
+        po::notify(opt);
+    } catch (...) {
+        cout << "Usage: " << argv[0] << ": [options]" << endl;
+        cout << cmd_options << "\n";
+        exit(1);
+    }
+    if (opt.count("help")) {
+        cout << "Usage: " << argv[0] << ": [options]" << endl;
+        cout << cmd_options << "\n";
+        exit(0);
+    }
+    if (geteuid() != 0) {
+        cerr << "Error: wsd has to run as root." << endl;
+        exit(1);
+    }
+    if (maxchildren < 1) maxchildren = 1;
+
+    openlog("wsd", LOG_PID, LOG_DAEMON);
+    if (!loadconfig()) {
+        cerr << "Error: Could not read config file!" << endl;
+        exit(1);
+    }
+    string stamp = configstamp();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketname.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: socket name too long." << endl;
+        exit(1);
+    }
+    strcpy(addr.sun_path, socketname.c_str());
+    unlink(socketname.c_str());
+    listenfd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (listenfd < 0 || bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        chmod(socketname.c_str(), 0666) != 0 || listen(listenfd, 128) != 0) {
+        cerr << "Error: can not listen on " << socketname << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+
+    if (pipe2(sigpipe, O_CLOEXEC|O_NONBLOCK) != 0) {
+        cerr << "Error: can not create pipe: " << strerror(errno) << endl;
+        exit(1);
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onsignal;
+    sa.sa_flags = SA_RESTART|SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+
+    syslog(LOG_INFO, "listening on %s", socketname.c_str());
+
+    // connections of running children, the exit status is sent over them
+    map<pid_t, int> children;
+
+    while (!stopping || !children.empty()) {
+        struct pollfd fds[2];
+        fds[0].fd = sigpipe[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = listenfd;
+        fds[1].events = POLLIN;
+        int nfds = (!stopping && (int)children.size() < maxchildren) ? 2 : 1;
+        if (poll(fds, nfds, -1) < 0 && errno != EINTR) {
+            syslog(LOG_ERR, "poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char buf[64];
+            while (read(sigpipe[0], buf, sizeof(buf)) > 0);
+        }
+
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            auto it = children.find(pid);
+            if (it == children.end()) continue;
+            int32_t result = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            if (send(it->second, &result, sizeof(result), MSG_NOSIGNAL) != sizeof(result)) {
+                // client is gone, nobody to tell
+            }
+            close(it->second);
+            children.erase(it);
+        }
+
+        if (stopping) {
+            if (listenfd >= 0) {
+                close(listenfd);
+                listenfd = -1;
+                unlink(socketname.c_str());
+            }
+            continue;
+        }
+
+        if (nfds < 2 || !(fds[1].revents & POLLIN)) continue;
+        int conn = accept4(listenfd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) continue;
+
+        struct ucred cred;
+        socklen_t credlen = sizeof(cred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) != 0) {
+            close(conn);
+            continue;
+        }
+
+        // the children see the changed config
+        string newstamp = configstamp();
+        if (newstamp != stamp) {
+            syslog(LOG_INFO, "config changed, loading it again");
+            loadconfig();
+            stamp = newstamp;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            for (auto const &c : children) close(c.second);
+            serve(conn, cred);
+        }
+        if (pid < 0) {
+            syslog(LOG_ERR, "fork failed: %s", strerror(errno));
+            close(conn);
+            continue;
+        }
+        children[pid] = conn;
+    }
+
+    if (listenfd >= 0) unlink(socketname.c_str());
+    syslog(LOG_INFO, "stopped");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef WSD_H
+#define WSD_H
+
+/*
+ *  workspace++
+ *
+ *  wsd, optional daemon serving ws_allocate and ws_release
+ *
+ *  wsd runs as root on a node and keeps the parsed config in memory, groups are looked up
+ *  in the child of each request, shared through the files of nsscache.
+ *  ws_allocate and ws_release hand their command line to it over a Unix socket, and only
+ *  do the work themselves if it does not run. The daemon takes uid and gid of the caller
+ *  from the socket (SO_PEERCRED) and forks a child for each request, which takes the
+ *  credentials of the caller like the setuid or capability binary would have them, gets
+ *  stdin, stdout and stderr of the caller and runs the same code as the binary.
+ *
+ *  protocol:
+ *    client:  uint32_t length, then length bytes of NUL terminated strings:
+ *               "wsd 1", program, argv[0] ... argv[argc-1]
+ *             file descriptors 0, 1 and 2 are passed with the first byte (SCM_RIGHTS)
+ *    server:  int32_t exit status of the program when it is done, 128+signal if it
+ *             was killed, nothing if the request could not be read
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+
+using namespace std;
+
+#ifndef WSD_SOCKET
+#define WSD_SOCKET "/run/wsd.sock"
+#endif
+
+const char WSD_MAGIC[] = "wsd 1";
+const unsigned WSD_MAXREQUEST = 64*1024;
+// seconds a client waits for the exit status, a wsd that hangs must not keep it forever,
+// a deletion in the foreground with ws_release --delete-data can take long as well
+const int WSD_TIMEOUT = 600;
+
+
+class WsdClient {
+
+public:
+    // run program with argv in wsd and exit with its status, returns only if wsd
+    // does not run, the caller does the work itself then
+    static void delegate(const string program, int argc, char **argv);
+};
+
+
+// the programs, called by their main() or by wsd
+int ws_allocate(int argc, char **argv);
+int ws_release(int argc, char **argv);
+
+#endif
@@ -33,11 +33,13 @@
 // C++
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <iostream>
 #include <vector>
 
 // Posix
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <signal.h>
 
@@ -51,6 +53,8 @@
 
 #include "wsdb.h"
 #include "ws.h"
+#include "fscred.h"
+#include "pathstats.h"
 
 using namespace std;
 
@@ -63,7 +67,7 @@ WsDB::WsDB(const string _filename, const string _wsdir, const long int _expirati
            const int _dbgid, const int _reminder, const string _mailaddress, const string _group, const string _comment)
     :
     dbfilename(_filename), wsdir(_wsdir), expiration(_expiration), extensions(_extensions),
-    acctcode(_acctcode), dbuid(_dbuid), dbgid(_dbgid), reminder(_reminder), mailaddress(_mailaddress), group(_group), comment(_comment), released(0)
+    acctcode(_acctcode), dbuid(_dbuid), dbgid(_dbgid), reminder(_reminder), mailaddress(_mailaddress), group(_group), comment(_comment), released(0), valid(true)
 {
     write_dbfile();
 }
@@ -71,9 +75,18 @@ WsDB::WsDB(const string _filename, const string _wsdir, const long int _expirati
 /*
  *  open db entry for reading
  */
-WsDB::WsDB(const string _filename, const int _dbuid, const int _dbgid) : dbfilename(_filename), dbuid(_dbuid), dbgid(_dbgid), released(0)
+WsDB::WsDB(const string _filename, const int _dbuid, const int _dbgid, const bool strict) : dbfilename(_filename), dbuid(_dbuid), dbgid(_dbgid), released(0), valid(true)
 {
-    read_dbfile();
+    if (strict) {
+        read_dbfile(true);
+    } else {
+        // used for scanning the whole DB, do not stop at broken entries
+        try {
+            read_dbfile(false);
+        } catch (...) {
+            valid = false;
+        }
+    }
 }
 
 /*
@@ -98,8 +111,43 @@ void WsDB::use_extension(const long _expiration, const string _mailaddress, cons
 
 
 
-// write data to file
-void WsDB::write_dbfile()
+/*
+ * write data to the DB file in the directory of index and put it into the index,
+ * all relative to the directory already opened by the index
+ */
+void WsDB::store(WsIndex &index, const string &data, const int perm)
+{
+    int dirfd = index.getdirfd();
+    string id = dbfilename.substr(dbfilename.rfind('/')+1);
+    int fd;
+    if (dirfd >= 0) {
+        PathStats::names()++;
+        fd = openat(dirfd, id.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, perm);
+    } else {
+        PathStats::paths()++;
+        fd = open(dbfilename.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, perm);
+    }
+    if (fd < 0 || write(fd, data.data(), data.size()) != (ssize_t)data.size()) {
+        cerr << "Error: could not write DB file! Please check if the outcome is as expected, you might have to make a backup of the workspace to prevent loss of data!"  << endl;
+    }
+    // mode of open() is reduced by the umask, and an existing file keeps its mode
+    if (fd < 0 || fchmod(fd, perm) != 0) {
+        cerr << "Error: could not change permissions of database entry" << endl;
+    }
+#ifndef SETUID
+    if (fd < 0 || fchown(fd, dbuid, dbgid) != 0) {
+        cerr << "Error: could not change owner of database entry" << endl;
+    }
+#endif
+    if (fd >= 0) close(fd);
+    if (index.isfresh()) {
+        index.put(getindexentry(dbfilename, dirfd));
+    }
+}
+
+// write data to file, in the directory of index if given, the caller has the credentials
+// for it and commits it then
+void WsDB::write_dbfile(WsIndex *index)
 {
     int perm;
     YAML::Node entry;
@@ -120,52 +168,67 @@ void WsDB::write_dbfile()
 	// suppress ctrl-c to prevent broken DB entries when FS is hanging and user gets nervous
 	signal(SIGINT,SIG_IGN);
 
-    Workspace::raise_cap(CAP_DAC_OVERRIDE, __LINE__, __FILE__);
-#ifdef SETUID
-    // for filesystem with root_squash, we need to be DB user here
-    if (setegid(dbgid)|| seteuid(dbuid)) {
-			cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
-			exit(-1);
-	}
-#endif
-    ofstream fout(dbfilename.c_str());
-    if(!(fout << entry)) cerr << "Error: could not write DB file! Please check if the outcome is as expected, you might have to make a backup of the workspace to prevent loss of data!"  << endl;
-    fout.close();
     if (group.length()>0) {
         // for group workspaces, we set the x-bit
         perm = 0744;
     } else {
         perm = 0644;
     }
-    Workspace::raise_cap(CAP_FOWNER, __LINE__, __FILE__);
-    if (chmod(dbfilename.c_str(), perm) != 0) {
-        cerr << "Error: could not change permissions of database entry" << endl;
-    }
-    Workspace::lower_cap(CAP_FOWNER, dbuid);
+    stringstream content;
+    content << entry;
+
+    if (index) {
+        store(*index, content.str(), perm);
+    } else {
 #ifdef SETUID
-    if(seteuid(0)|| setegid(0)) {
-			cerr << "Error: can not seteuid or setgid. Bad installation?" << endl;
-			exit(-1);
-	}
+        // for filesystem with root_squash, we need to be DB user here
+        FsCred dbcred(dbuid, dbgid);
+#else
+        // everything needed for the entry and the index at once
+        CapScope caps({CAP_DAC_OVERRIDE, CAP_FOWNER, CAP_CHOWN}, __LINE__, __FILE__);
 #endif
-    Workspace::lower_cap(CAP_DAC_OVERRIDE, dbuid);
-
-#ifndef SETUID
-    Workspace::raise_cap(CAP_CHOWN, __LINE__, __FILE__);
-    if (chown(dbfilename.c_str(), dbuid, dbgid)) {
-        Workspace::lower_cap(CAP_CHOWN, dbuid);
-        cerr << "Error: could not change owner of database entry" << endl;
+        // open index before the directory is changed, it is only kept if it is up to date
+        WsIndex dbindex(dbfilename.substr(0, dbfilename.rfind('/')+1));
+        store(dbindex, content.str(), perm);
+        dbindex.commit(dbuid, dbgid);
     }
-    Workspace::lower_cap(CAP_CHOWN, dbuid);
-#endif
 
 	// normal signal handling
 	signal(SIGINT,SIG_DFL);
 }
 
+/*
+ * index record for this entry, stored under the name of filename
+ */
+WsIndexEntry WsDB::getindexentry(const string filename, const int dirfd)
+{
+    WsIndexEntry e;
+    e.id = filename.substr(filename.rfind('/')+1);
+    e.workspace = wsdir;
+    e.group = group;
+    e.acctcode = acctcode;
+    e.mailaddress = mailaddress;
+    e.comment = comment;
+    e.expiration = expiration;
+    e.released = released;
+    e.extensions = extensions;
+    e.reminder = reminder;
+    e.flags = group.length()>0 ? WSINDEX_GROUP : 0;
+    struct stat st;
+    if (dirfd >= 0) {
+        PathStats::names()++;
+        e.ctime = fstatat(dirfd, e.id.c_str(), &st, 0)==0 ? st.st_ctime : 0;
+    } else {
+        PathStats::paths()++;
+        e.ctime = stat(filename.c_str(), &st)==0 ? st.st_ctime : 0;
+    }
+    return e;
+}
+
 // read data from file
-void WsDB::read_dbfile()
+void WsDB::read_dbfile(const bool strict)
 {
+    PathStats::paths()++;
     YAML::Node entry = YAML::LoadFile(dbfilename);
     try {
         wsdir = entry["workspace"].as<string>();
@@ -180,6 +243,7 @@ void WsDB::read_dbfile()
 		// FIXME group missing here?
 		group = entry["group"].as<string>("");
 		// FIXME empty group or current group if no group in DB?
+        released = entry["released"].as<long>(0);
     } catch (const YAML::BadSubscript&) {
         // fallback to old db format, python version
         ifstream entry (dbfilename.c_str());
@@ -191,14 +255,34 @@ void WsDB::read_dbfile()
         getline(entry, line); // newline
         getline(entry, line); // acctcode
         boost::split(sp, line, boost::is_any_of(":"));
+        if (sp.size() < 2) {
+            if (!strict) {
+                valid = false;
+                return;
+            }
+            cerr << "invalid db entry, aborting." << endl;
+            exit(-2);
+        }
         acctcode = sp[1];
         getline(entry, line); // extension
         boost::split(sp, line, boost::is_any_of(":"));
+        if (sp.size() < 2) {
+            if (!strict) {
+                valid = false;
+                return;
+            }
+            cerr << "invalid db entry, aborting." << endl;
+            exit(-2);
+        }
         extensions = boost::lexical_cast<int>(sp[1]);
         entry.close();
         mailaddress = "";
         reminder = 0;
 	} catch (const YAML::Exception&) {
+        if (!strict) {
+            valid = false;
+            return;
+        }
 		cerr << "invalid db entry, aborting." << endl;
 		exit(-2);
     }
@@ -36,6 +36,8 @@
 
 #include <string>
 
+#include "wsindex.h"
+
 
 using namespace std;
 
@@ -64,13 +66,16 @@ private:
     string group;
     string comment;
     long released;
+    bool valid;
 
-    void read_dbfile();
+    void read_dbfile(const bool strict);
+    void store(WsIndex &index, const string &data, const int perm);
 
 
 public:
     // constructor to query a DB entry, this reads the database entry
-    WsDB(const string filename, const int dbuid, const int dbgid);
+    // if strict is false, a broken entry does not abort but is reported by isvalid()
+    WsDB(const string filename, const int dbuid, const int dbgid, const bool strict=true);
 
     // constructor to create a new DB entry
     WsDB(const string filename, const string wsdir, const long expiration, const int extensions,
@@ -103,7 +108,17 @@ public:
         return wsdir;
     }
 
-    void write_dbfile();
+    bool isvalid() {
+        return valid;
+    }
+
+    // entry for the DB index, id and ctime are taken from filename,
+    // relative to dirfd if that is the directory of filename
+    WsIndexEntry getindexentry(const string filename, const int dirfd=-1);
+
+    // index is the DB directory opened and locked by the caller, who commits it,
+    // or NULL to open and commit it here
+    void write_dbfile(WsIndex *index=NULL);
 };
 
 #endif
@@ -0,0 +1,173 @@
+/*
+ *  workspace++
+ *
+ *  client side of wsd, used by ws_allocate and ws_release
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <string>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef SETUID
+#include <sys/capability.h>
+#endif
+
+#include "wsd.h"
+
+using namespace std;
+
+
+/*
+ * wsd does the work from here on, nothing needs privileges anymore
+ */
+static void dropprivileges()
+{
+#ifdef SETUID
+    uid_t uid = getuid();
+    if (setresuid(uid, uid, uid) != 0) {
+        // still running as the user only, seteuid was done before connect
+    }
+#else
+    cap_t caps = cap_init();
+    cap_set_proc(caps);
+    cap_free(caps);
+#endif
+}
+
+static bool readall(int fd, void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+
+void WsdClient::delegate(const string program, int argc, char **argv)
+{
+    // a daemon is only trusted if root made its socket
+    struct stat st;
+    if (lstat(WSD_SOCKET, &st) != 0 || !S_ISSOCK(st.st_mode) || st.st_uid != 0) return;
+
+    // we pass our terminal, it has to be there
+    for (int fd = 0; fd < 3; fd++) {
+        if (fcntl(fd, F_GETFD) < 0) return;
+    }
+
+    string request;
+    request.append(WSD_MAGIC, sizeof(WSD_MAGIC));
+    request.append(program.c_str(), program.size() + 1);
+    for (int i = 0; i < argc; i++) {
+        request.append(argv[i], strlen(argv[i]) + 1);
+    }
+    if (request.size() > WSD_MAXREQUEST) return;
+    uint32_t length = request.size();
+    request.insert(0, (const char *)&length, sizeof(length));
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, WSD_SOCKET, sizeof(addr.sun_path) - 1);
+
+    // wsd takes the credentials of connect(), so connect as the user and not as root
+    uid_t euid = geteuid();
+    if (seteuid(getuid()) != 0) return;
+
+    int sock = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (sock >= 0) close(sock);
+        if (seteuid(euid) != 0) {
+            cerr << "Error: can not change uid. (line " << __LINE__ << ")" << endl;
+            exit(1);
+        }
+        return;
+    }
+
+    struct iovec iov;
+    iov.iov_base = &request[0];
+    iov.iov_len = request.size();
+    union {
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    int fds[3] = {0, 1, 2};
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    // nothing was done if the request did not get through
+    ssize_t sent;
+    do {
+        sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent != (ssize_t)request.size()) {
+        close(sock);
+        if (seteuid(euid) != 0) {
+            cerr << "Error: can not change uid. (line " << __LINE__ << ")" << endl;
+            exit(1);
+        }
+        return;
+    }
+
+    dropprivileges();
+
+    struct timeval timeout = {WSD_TIMEOUT, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int32_t status;
+    errno = 0;
+    if (!readall(sock, &status, sizeof(status))) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            cerr << "Error: wsd did not answer within " << WSD_TIMEOUT
+                 << " seconds, the request may still be running, check if it was done." << endl;
+        } else {
+            cerr << "Error: lost connection to wsd, check if the request was done." << endl;
+        }
+        exit(1);
+    }
+    close(sock);
+    exit(status);
+}
@@ -0,0 +1,617 @@
+/*
+ *  workspace++
+ *
+ *  sidecar index of a DB directory
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <string.h>
+
+// Posix
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wsindex.h"
+#include "pathstats.h"
+
+using namespace std;
+
+static_assert(sizeof(WsIndexHeader) == 64, "index header has to be 64 bytes");
+static_assert(sizeof(WsIndexRecord) == 96, "index record has to be 96 bytes");
+static_assert(sizeof(WsIndexLogStamp) == 32, "index stamp has to be 32 bytes");
+
+static const char MAGIC[8] = { 'W', 'S', 'D', 'B', 'I', 'D', 'X', 0 };
+
+// log size from which a writer compacts the index, if it is larger than the rest of the index
+static const uint64_t WSINDEX_COMPACT = 1 << 20;
+
+
+/*
+ * names in a DB directory that look like DB entries, dir is closed
+ */
+static void scan_dbdir(DIR *dir, function<void(const char *)> found)
+{
+    if (dir == NULL) return;
+    struct dirent *d;
+    while ((d = readdir(dir)) != NULL) {
+        // skips ., .., the index, the magic file and the deleted directory
+        if (d->d_name[0] == '.') continue;
+        if (strchr(d->d_name, '-') == NULL) continue;
+        if (d->d_type == DT_DIR) continue;
+        found(d->d_name);
+    }
+    closedir(dir);
+}
+
+
+WsIndex::WsIndex(const string _dbdir)
+    : dbdir(_dbdir), locked(false), fresh(false), cleared(false), loaded(false), basesize(0), logsize(0)
+{
+    before.tv_sec = before.tv_nsec = 0;
+    PathStats::paths()++;
+    dirfd = open(dbdir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dirfd < 0) return;
+    // serialize writers, filesystems without flock support just run unlocked
+    if (flock(dirfd, LOCK_EX) == 0) locked = true;
+    fresh = check();
+}
+
+WsIndex::~WsIndex()
+{
+    if (dirfd >= 0) {
+        if (locked) flock(dirfd, LOCK_UN);
+        close(dirfd);
+    }
+}
+
+WsIndexReader::WsIndexReader(int dirfd, bool checkfresh)
+    : map(NULL), mapsize(0), header(NULL), maxreminder(0), mtime{0, 0}
+{
+    open(dirfd, checkfresh);
+}
+
+WsIndexReader::WsIndexReader(const string dbdir, bool checkfresh)
+    : map(NULL), mapsize(0), header(NULL), maxreminder(0), mtime{0, 0}
+{
+    PathStats::paths()++;
+    int dirfd = ::open(dbdir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dirfd < 0) return;
+    open(dirfd, checkfresh);
+    close(dirfd);
+}
+
+WsIndexReader::~WsIndexReader()
+{
+    if (map) munmap(map, mapsize);
+}
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+static bool validstamp(const WsIndexLogStamp &s)
+{
+    return s.head.size == sizeof(WsIndexLogStamp) && s.head.op == WSINDEX_STAMP &&
+           memcmp(s.magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+static bool validheader(const WsIndexHeader &h, uint64_t filesize)
+{
+    return memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == WSINDEX_VERSION &&
+           h.recordsize == sizeof(WsIndexRecord) && h.records <= UINT32_MAX &&
+           sizeof(WsIndexHeader) + h.records * (sizeof(WsIndexRecord) + sizeof(uint32_t)) <= h.stringoffset &&
+           align8(h.stringoffset + h.stringsize) <= filesize;
+}
+
+// all strings of record r inside a string table of size n
+static bool inside(const WsIndexRecord &r, uint64_t n)
+{
+    auto in = [n](uint32_t off, uint32_t len) { return (uint64_t)off + len <= n; };
+    return in(r.id_off, r.id_len) && in(r.workspace_off, r.workspace_len) && in(r.group_off, r.group_len) &&
+           in(r.acctcode_off, r.acctcode_len) && in(r.mail_off, r.mail_len) && in(r.comment_off, r.comment_len);
+}
+
+/*
+ * map index and check it completely, merge the log, header stays NULL if missing, broken or outdated
+ */
+void WsIndexReader::open(int dirfd, bool checkfresh)
+{
+    struct stat dst, ist;
+    if (fstat(dirfd, &dst) != 0) return;
+
+    PathStats::names()++;
+    int fd = openat(dirfd, WSINDEX_NAME, O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) return;
+    // only trust an index written by root or the owner of the DB
+    if (fstat(fd, &ist) != 0 || ist.st_size < (off_t)sizeof(WsIndexHeader) ||
+        (ist.st_uid != 0 && ist.st_uid != dst.st_uid)) {
+        close(fd);
+        return;
+    }
+    map = mmap(NULL, ist.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        map = NULL;
+        return;
+    }
+    mapsize = ist.st_size;
+
+    const char *base = (const char *)map;
+    const WsIndexHeader *h = (const WsIndexHeader *)base;
+    if (!validheader(*h, mapsize)) return;
+    const WsIndexRecord *r = (const WsIndexRecord *)(base + sizeof(WsIndexHeader));
+    const uint32_t *o = (const uint32_t *)(r + h->records);
+    const char *strings = base + h->stringoffset;
+    // check all strings and the order once, so get() does not have to
+    for (uint64_t i = 0; i < h->records; i++) {
+        if (!inside(r[i], h->stringsize) || o[i] >= h->records) return;
+    }
+
+    // the log, a batch counts once its stamp is there, a writer might still append to it
+    vector<pair<uint32_t, Item>> log;
+    size_t batch = 0;
+    int64_t mtime_sec = h->mtime_sec, mtime_nsec = h->mtime_nsec;
+    uint64_t off = align8(h->stringoffset + h->stringsize);
+    while (off + sizeof(WsIndexLogHead) <= mapsize) {
+        const WsIndexLogHead *l = (const WsIndexLogHead *)(base + off);
+        if (l->size < sizeof(WsIndexLogHead) || l->size % 8 != 0 || off + l->size > mapsize) break;
+        if (l->op == WSINDEX_STAMP) {
+            const WsIndexLogStamp *s = (const WsIndexLogStamp *)l;
+            if (!validstamp(*s)) break;
+            mtime_sec = s->mtime_sec;
+            mtime_nsec = s->mtime_nsec;
+            batch = log.size();
+        } else {
+            if ((l->op != WSINDEX_PUT && l->op != WSINDEX_REMOVE) ||
+                l->size < sizeof(WsIndexLogHead) + sizeof(WsIndexRecord)) break;
+            const WsIndexRecord *lr = (const WsIndexRecord *)(l + 1);
+            if (!inside(*lr, l->size - sizeof(WsIndexLogHead) - sizeof(WsIndexRecord))) break;
+            log.push_back(make_pair(l->op, Item{lr, (const char *)(lr + 1)}));
+        }
+        off += l->size;
+    }
+    log.resize(batch);
+    mtime.tv_sec = mtime_sec;
+    mtime.tv_nsec = mtime_nsec;
+
+    if (checkfresh && (mtime_sec != dst.st_mtim.tv_sec || mtime_nsec != dst.st_mtim.tv_nsec)) return;
+
+    maxreminder = h->maxreminder;
+    if (log.empty()) {
+        items.reserve(h->records);
+        for (uint64_t i = 0; i < h->records; i++) items.push_back(Item{r + i, strings});
+        order.assign(o, o + h->records);
+    } else {
+        // last change of an id wins, a remove leaves no record
+        std::map<string, Item> changes;
+        for (auto const &it : log) {
+            const Item &c = it.second;
+            changes[string(c.strings + c.record->id_off, c.record->id_len)] =
+                it.first == WSINDEX_PUT ? c : Item{NULL, NULL};
+            if (it.first == WSINDEX_PUT) maxreminder = max(maxreminder, c.record->reminder);
+        }
+        // both sorted by id, merge them
+        items.reserve(h->records + changes.size());
+        uint64_t i = 0;
+        auto c = changes.begin();
+        while (i < h->records || c != changes.end()) {
+            int cmp = i == h->records ? -1 : c == changes.end() ? 1 :
+                      c->first.compare(0, string::npos, strings + r[i].id_off, r[i].id_len);
+            if (cmp <= 0) {
+                if (c->second.record) items.push_back(c->second);
+                c++;
+                // replaced or removed
+                if (cmp == 0) i++;
+            } else {
+                items.push_back(Item{r + i, strings});
+                i++;
+            }
+        }
+        order.resize(items.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        // stable keeps the order of ids for the same expiration
+        stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return items[a].record->expiration < items[b].record->expiration;
+        });
+    }
+
+    // with timestamps in seconds, a change in the second the index was written keeps the mtime,
+    // the number of entries has to match as well then
+    if (checkfresh && mtime_nsec == 0 && ist.st_mtim.tv_sec <= mtime_sec) {
+        uint64_t n = 0;
+        PathStats::names()++;
+        int fd = openat(dirfd, ".", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+        if (fd < 0) return;
+        DIR *dir = fdopendir(fd);
+        if (dir == NULL) {
+            close(fd);
+            return;
+        }
+        scan_dbdir(dir, [&n](const char *) { n++; });
+        if (n != items.size()) return;
+    }
+    header = h;
+}
+
+WsIndexEntry WsIndexReader::get(uint64_t i) const
+{
+    const WsIndexRecord *r = items[i].record;
+    const char *s = items[i].strings;
+    WsIndexEntry e;
+    e.id = string(s + r->id_off, r->id_len);
+    e.workspace = string(s + r->workspace_off, r->workspace_len);
+    e.group = string(s + r->group_off, r->group_len);
+    e.acctcode = string(s + r->acctcode_off, r->acctcode_len);
+    e.mailaddress = string(s + r->mail_off, r->mail_len);
+    e.comment = string(s + r->comment_off, r->comment_len);
+    e.expiration = r->expiration;
+    e.released = r->released;
+    e.ctime = r->ctime;
+    e.extensions = r->extensions;
+    e.reminder = r->reminder;
+    e.flags = r->flags;
+    return e;
+}
+
+bool WsIndexReader::find(const string id, WsIndexEntry &e) const
+{
+    uint64_t lo = 0, hi = size();
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        const Item &it = items[mid];
+        int c = id.compare(0, string::npos, it.strings + it.record->id_off, it.record->id_len);
+        if (c == 0) {
+            e = get(mid);
+            return true;
+        }
+        if (c < 0) hi = mid; else lo = mid + 1;
+    }
+    return false;
+}
+
+void WsIndexReader::due(long until, function<bool(const WsIndexEntry &)> found) const
+{
+    for (uint64_t i = 0; i < size(); i++) {
+        if (items[order[i]].record->expiration > until) break;
+        if (!found(get(order[i]))) break;
+    }
+}
+
+
+/*
+ * is the index up to date, only reads header and the last stamp, the reader checks the rest
+ */
+bool WsIndex::check()
+{
+    struct stat dst, ist;
+    if (fstat(dirfd, &dst) != 0) return false;
+    PathStats::names()++;
+    int fd = openat(dirfd, WSINDEX_NAME, O_RDONLY|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) return false;
+    WsIndexHeader h;
+    WsIndexLogStamp s;
+    bool ok = fstat(fd, &ist) == 0 && (ist.st_uid == 0 || ist.st_uid == dst.st_uid) &&
+              pread(fd, &h, sizeof(h), 0) == sizeof(h) && validheader(h, ist.st_size);
+    if (ok) {
+        basesize = align8(h.stringoffset + h.stringsize);
+        logsize = ist.st_size - basesize;
+        s.mtime_sec = h.mtime_sec;
+        s.mtime_nsec = h.mtime_nsec;
+        // a batch cut off by a crash leaves no stamp at the end, nothing is appended to that
+        if (logsize > 0) {
+            ok = logsize >= sizeof(s) &&
+                 pread(fd, &s, sizeof(s), ist.st_size - sizeof(s)) == sizeof(s) && validstamp(s);
+        }
+    }
+    close(fd);
+    if (!ok || s.mtime_sec != dst.st_mtim.tv_sec || s.mtime_nsec != dst.st_mtim.tv_nsec) return false;
+    // the entries are those of this time, until own changes
+    before = dst.st_mtim;
+    // timestamps in seconds need the count of entries, from the reader
+    if (s.mtime_nsec == 0) return WsIndexReader(dirfd).isvalid();
+    return true;
+}
+
+/*
+ * read index into memory and apply the changes so far, returns false if missing or broken,
+ * the directory might have changed since check() by own changes, the index must not have
+ */
+bool WsIndex::load()
+{
+    WsIndexReader reader(dirfd, false);
+    for (uint64_t i = 0; i < reader.size(); i++) {
+        WsIndexEntry e = reader.get(i);
+        entries[e.id] = e;
+    }
+    for (auto const &it : log) {
+        if (it.first == WSINDEX_PUT) entries[it.second.id] = it.second; else entries.erase(it.second.id);
+    }
+    loaded = true;
+    return reader.isvalid() &&
+           reader.getmtime().tv_sec == before.tv_sec && reader.getmtime().tv_nsec == before.tv_nsec;
+}
+
+const map<string, WsIndexEntry> &WsIndex::getentries()
+{
+    if (!loaded && !load()) fresh = false;
+    return entries;
+}
+
+void WsIndex::put(const WsIndexEntry &entry)
+{
+    log.push_back(make_pair(WSINDEX_PUT, entry));
+    if (loaded) entries[entry.id] = entry;
+}
+
+void WsIndex::remove(const string id)
+{
+    WsIndexEntry e;
+    e.id = id;
+    e.expiration = e.released = e.ctime = 0;
+    e.extensions = e.reminder = 0;
+    e.flags = 0;
+    log.push_back(make_pair(WSINDEX_REMOVE, e));
+    if (loaded) entries.erase(id);
+}
+
+void WsIndex::clear()
+{
+    entries.clear();
+    log.clear();
+    fresh = true;
+    cleared = true;
+    loaded = true;
+    // entries are read after this, changes of others from now on are found by rewrite()
+    struct stat dst;
+    if (dirfd >= 0 && fstat(dirfd, &dst) == 0) before = dst.st_mtim;
+}
+
+/*
+ * directory still has the mtime of the time the entries were read
+ */
+bool WsIndex::unchanged()
+{
+    struct stat dst;
+    return fstat(dirfd, &dst) == 0 &&
+           dst.st_mtim.tv_sec == before.tv_sec && dst.st_mtim.tv_nsec == before.tv_nsec;
+}
+
+static void fillrecord(WsIndexRecord &r, const WsIndexEntry &e, string &strings)
+{
+    auto add = [&strings](const string &s, uint32_t &off, uint32_t &len) {
+        off = strings.size();
+        len = s.size();
+        strings += s;
+    };
+    memset(&r, 0, sizeof(r));
+    r.expiration = e.expiration;
+    r.released = e.released;
+    r.ctime = e.ctime;
+    r.extensions = e.extensions;
+    r.reminder = e.reminder;
+    r.flags = e.flags;
+    size_t dash = e.id.find('-');
+    r.ownerlen = dash == string::npos ? 0 : dash;
+    add(e.id, r.id_off, r.id_len);
+    add(e.workspace, r.workspace_off, r.workspace_len);
+    add(e.group, r.group_off, r.group_len);
+    add(e.acctcode, r.acctcode_off, r.acctcode_len);
+    add(e.mailaddress, r.mail_off, r.mail_len);
+    add(e.comment, r.comment_off, r.comment_len);
+}
+
+/*
+ * append the changes and the mtime of the directory after them in one write, a reader or
+ * a crash in between sees a batch without stamp and ignores it
+ */
+bool WsIndex::append()
+{
+    string batch;
+    for (auto const &it : log) {
+        WsIndexRecord r;
+        string strings;
+        fillrecord(r, it.second, strings);
+        strings.resize(align8(strings.size()), '\0');
+        WsIndexLogHead l = { (uint32_t)(sizeof(l) + sizeof(r) + strings.size()), it.first };
+        batch.append((const char *)&l, sizeof(l));
+        batch.append((const char *)&r, sizeof(r));
+        batch += strings;
+    }
+    struct stat dst;
+    if (fstat(dirfd, &dst) != 0) return false;
+    WsIndexLogStamp s;
+    memset(&s, 0, sizeof(s));
+    s.head.size = sizeof(s);
+    s.head.op = WSINDEX_STAMP;
+    s.mtime_sec = dst.st_mtim.tv_sec;
+    s.mtime_nsec = dst.st_mtim.tv_nsec;
+    memcpy(s.magic, MAGIC, sizeof(MAGIC));
+    batch.append((const char *)&s, sizeof(s));
+
+    PathStats::names()++;
+    int fd = openat(dirfd, WSINDEX_NAME, O_WRONLY|O_APPEND|O_CLOEXEC|O_NOFOLLOW);
+    if (fd < 0) return false;
+    bool ok = write(fd, batch.data(), batch.size()) == (ssize_t)batch.size();
+    if (close(fd) != 0) ok = false;
+    if (!ok) {
+        // a part of the batch might be there, the next writer would append behind it
+        invalidate();
+        return false;
+    }
+    logsize += batch.size();
+    log.clear();
+    return true;
+}
+
+/*
+ * write a new index without log and rename it over the old one, the mtime of the directory
+ * after the rename is stored last, so readers never accept a half written index. If the
+ * directory changed since the entries were read, the index is removed instead.
+ */
+bool WsIndex::rewrite(int uid, int gid)
+{
+    WsIndexHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = WSINDEX_VERSION;
+    h.recordsize = sizeof(WsIndexRecord);
+    h.records = entries.size();
+    h.stringoffset = sizeof(WsIndexHeader) + entries.size() * (sizeof(WsIndexRecord) + sizeof(uint32_t));
+
+    vector<WsIndexRecord> records(entries.size());
+    string strings;
+    size_t n = 0;
+    // map is sorted by id, so is the index
+    for (auto const &it : entries) {
+        fillrecord(records[n++], it.second, strings);
+        h.maxreminder = max(h.maxreminder, (int32_t)it.second.reminder);
+    }
+    h.stringsize = strings.size();
+    // the log starts at a multiple of 8
+    strings.resize(align8(h.stringoffset + h.stringsize) - h.stringoffset, '\0');
+
+    vector<uint32_t> order(records.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    // stable keeps the order of ids for the same expiration
+    stable_sort(order.begin(), order.end(), [&records](uint32_t a, uint32_t b) {
+        return records[a].expiration < records[b].expiration;
+    });
+
+    // without a name until it is complete and belongs to uid, like writetrusted()
+    string tmpname = string(WSINDEX_NAME) + ".tmp";
+    bool named = false;
+    PathStats::names() += 3;    // link or open, and both names of the rename
+    int fd = openat(dirfd, ".", O_RDWR|O_TMPFILE|O_CLOEXEC, 0600);
+    if (fd < 0) {
+        if (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL) return false;
+        if (!unchanged()) {
+            invalidate();
+            return false;
+        }
+        unlinkat(dirfd, tmpname.c_str(), 0);
+        fd = openat(dirfd, tmpname.c_str(), O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC|O_NOFOLLOW, 0600);
+        if (fd < 0) return false;
+        named = true;
+    }
+    bool ok = true;
+    if (write(fd, &h, sizeof(h)) != sizeof(h)) ok = false;
+    size_t rsize = records.size() * sizeof(WsIndexRecord);
+    if (ok && rsize > 0 && write(fd, records.data(), rsize) != (ssize_t)rsize) ok = false;
+    size_t osize = order.size() * sizeof(uint32_t);
+    if (ok && osize > 0 && write(fd, order.data(), osize) != (ssize_t)osize) ok = false;
+    if (ok && strings.size() > 0 && write(fd, strings.data(), strings.size()) != (ssize_t)strings.size()) ok = false;
+    struct stat ist;
+    if (ok) {
+        fchmod(fd, 0644);
+        // ignore errors, we might already be the right user, readers check the owner
+        if (fchown(fd, uid, gid)) {};
+        ok = fstat(fd, &ist) == 0 && (uid == -1 || ist.st_uid == (uid_t)uid);
+    }
+    if (ok && !named) {
+        // last moment before the directory is changed by the index itself
+        if (!unchanged()) {
+            close(fd);
+            invalidate();
+            return false;
+        }
+        // linkat with AT_EMPTY_PATH would need CAP_DAC_READ_SEARCH, the link in /proc does not
+        string procname = "/proc/self/fd/" + to_string(fd);
+        unlinkat(dirfd, tmpname.c_str(), 0);
+        ok = linkat(AT_FDCWD, procname.c_str(), dirfd, tmpname.c_str(), AT_SYMLINK_FOLLOW) == 0;
+        named = ok;
+    }
+    if (!ok || renameat(dirfd, tmpname.c_str(), dirfd, WSINDEX_NAME) != 0) {
+        close(fd);
+        if (named) unlinkat(dirfd, tmpname.c_str(), 0);
+        return false;
+    }
+    struct stat dst;
+    if (fstat(dirfd, &dst) == 0) {
+        h.mtime_sec = dst.st_mtim.tv_sec;
+        h.mtime_nsec = dst.st_mtim.tv_nsec;
+        if (pwrite(fd, &h, sizeof(h), 0) != sizeof(h)) ok = false;
+    } else {
+        ok = false;
+    }
+    close(fd);
+    basesize = ist.st_size;
+    logsize = 0;
+    cleared = false;
+    log.clear();
+    return ok;
+}
+
+/*
+ * append the changes, or write the index anew after clear(), or when the log outgrew the
+ * index, so compacting costs the same per change as appending, on average
+ */
+bool WsIndex::commit(int uid, int gid)
+{
+    if (dirfd < 0 || !fresh) return false;
+    if (cleared) return rewrite(uid, gid);
+    if (log.empty()) return true;
+    if (logsize > max(basesize, WSINDEX_COMPACT)) {
+        if (!loaded && !load()) {
+            fresh = false;
+            return false;
+        }
+        // the entries are current now, only own changes happened since opening
+        struct stat dst;
+        if (fstat(dirfd, &dst) == 0) {
+            before = dst.st_mtim;
+            if (rewrite(uid, gid)) return true;
+        }
+        // e.g. a tool that can not give the file to the DB user, it appends then
+        if (!fresh) return false;
+    }
+    return append();
+}
+
+void WsIndex::invalidate()
+{
+    fresh = false;
+    cleared = false;
+    log.clear();
+    if (dirfd < 0) return;
+    PathStats::names()++;
+    unlinkat(dirfd, WSINDEX_NAME, 0);
+}
+
+/*
+ * all entries of a DB directory that look like DB entries
+ */
+vector<string> WsIndex::list_dbdir(const string dbdir)
+{
+    vector<string> ids;
+    scan_dbdir(opendir(dbdir.c_str()), [&ids](const char *name) { ids.push_back(name); });
+    sort(ids.begin(), ids.end());
+    return ids;
+}
@@ -0,0 +1,256 @@
+#ifndef WSINDEX_H
+#define WSINDEX_H
+
+/*
+ *  workspace++
+ *
+ *  sidecar index of a DB directory
+ *
+ *  the file .ws_db_index in each DB directory holds one fixed width record per DB entry,
+ *  followed by a table of the strings, so listing tools can mmap it and scan it instead of
+ *  opening and parsing each YAML file. The index is only valid if the modification time
+ *  of the DB directory matches the time stored last in the file, any change of the directory
+ *  not done through WsIndex (e.g. by hand) makes it stale, readers fall back to the YAML
+ *  files then, and writers leave it alone until it is rebuilt with ws_dbindex.
+ *  On filesystems with timestamps in seconds, a change in the second the index was written
+ *  would not be seen, the number of entries in the directory has to match there as well.
+ *
+ *  The tools do not rewrite the index for each change, they append the changed records to
+ *  a log behind the strings, each batch followed by the new mtime of the directory, so a
+ *  change costs the same for any size of DB. Readers merge the log into the records. Once
+ *  the log is larger than the rest, the next writer compacts it into a new index, and
+ *  ws_dbindex does after each run of ws_expirer. Writers hold a flock of the DB directory,
+ *  ws_expirer takes it too for each change of an entry.
+ *
+ *  layout (native byte order):
+ *    header  64 bytes:  magic "WSDBIDX\0", version, record size, number of records,
+ *                       offset and size of string table, mtime (sec, nsec) of directory,
+ *                       largest reminder of all records in days
+ *    records 96 bytes each, sorted by id (user-name):
+ *                       expiration, released, ctime, extensions, reminder, flags,
+ *                       length of owner in id, offset/length of id, workspace, group,
+ *                       acctcode, mailaddress and comment in string table
+ *    order   uint32_t per record, numbers of the records sorted by expiration, so
+ *            ws_expirer can read only the entries that are due (version 2)
+ *    strings
+ *    log     from the next multiple of 8 on, entries of size and operation, a put is a record
+ *            followed by its strings (offsets relative to them), a remove a record with only
+ *            the id, padded to 8 bytes, each batch ends with a stamp of the directory mtime,
+ *            entries after the last stamp are not used (version 3)
+ *
+ *  (c) Holger Berger 2026
+ *
+ *  workspace++ is based on workspace by Holger Berger, Thomas Beisel and Martin Hecht
+ *
+ *  workspace++ is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  workspace++ is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with workspace++.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string>
+#include <map>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include <time.h>
+
+using namespace std;
+
+const char WSINDEX_NAME[] = ".ws_db_index";
+const uint32_t WSINDEX_VERSION = 3;
+
+// operations in the log
+const uint32_t WSINDEX_PUT = 1;
+const uint32_t WSINDEX_REMOVE = 2;
+const uint32_t WSINDEX_STAMP = 3;
+
+// flags of a record
+const uint32_t WSINDEX_GROUP = 1;   // group workspace, DB entry has the x-bit set
+
+struct WsIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordsize;
+    uint64_t records;
+    uint64_t stringoffset;
+    uint64_t stringsize;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int32_t maxreminder;
+    uint32_t reserved;
+};
+
+struct WsIndexRecord {
+    int64_t expiration;
+    int64_t released;
+    int64_t ctime;
+    int32_t extensions;
+    int32_t reminder;
+    uint32_t flags;
+    uint32_t ownerlen;
+    uint32_t id_off, id_len;
+    uint32_t workspace_off, workspace_len;
+    uint32_t group_off, group_len;
+    uint32_t acctcode_off, acctcode_len;
+    uint32_t mail_off, mail_len;
+    uint32_t comment_off, comment_len;
+    uint64_t reserved;
+};
+
+struct WsIndexLogHead {
+    uint32_t size;          // of the whole log entry, multiple of 8
+    uint32_t op;
+};
+
+struct WsIndexLogStamp {
+    WsIndexLogHead head;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    char magic[8];
+};
+
+/*
+ * one entry as used in memory
+ */
+struct WsIndexEntry {
+    string id;             // name of DB file, user-name or user-name-timestamp
+    string workspace;
+    string group;
+    string acctcode;
+    string mailaddress;
+    string comment;
+    long expiration;
+    long released;
+    long ctime;
+    int extensions;
+    int reminder;
+    uint32_t flags;
+};
+
+
+/*
+ * read only access to a mapped index, without loading it into memory
+ */
+class WsIndexReader {
+
+private:
+    // a record of the index or of the log, with the strings its offsets refer to
+    struct Item {
+        const WsIndexRecord *record;
+        const char *strings;
+    };
+
+    void *map;
+    size_t mapsize;
+    const WsIndexHeader *header;
+    vector<Item> items;             // sorted by id
+    vector<uint32_t> order;         // numbers of items sorted by expiration
+    int32_t maxreminder;
+    struct timespec mtime;
+
+    void open(int dirfd, bool checkfresh);
+
+public:
+    // index is only used if it is valid and, with checkfresh, up to date
+    WsIndexReader(int dirfd, bool checkfresh=true);
+    WsIndexReader(const string dbdir, bool checkfresh=true);
+    ~WsIndexReader();
+
+    bool isvalid() const {
+        return header != NULL;
+    }
+
+    uint64_t size() const {
+        return items.size();
+    }
+
+    // largest reminder in days of all entries
+    int getmaxreminder() const {
+        return maxreminder;
+    }
+
+    // mtime of the directory the index is up to date with
+    struct timespec getmtime() const {
+        return mtime;
+    }
+
+    // record i, in order of ids
+    WsIndexEntry get(uint64_t i) const;
+
+    // entry with id, binary search
+    bool find(const string id, WsIndexEntry &e) const;
+
+    // entries with expiration <= until, in order of expiration, stops if found returns false
+    void due(long until, function<bool(const WsIndexEntry &)> found) const;
+};
+
+
+class WsIndex {
+
+private:
+    string dbdir;
+    int dirfd;
+    bool locked;
+    bool fresh;
+    bool cleared;
+    bool loaded;
+    struct timespec before;                     // mtime of directory when the entries were read
+    uint64_t basesize;                          // of the index without log
+    uint64_t logsize;
+    map<string, WsIndexEntry> entries;          // only after getentries() or clear()
+    vector<pair<uint32_t, WsIndexEntry>> log;   // changes not committed yet
+
+    bool check();
+    bool load();
+    bool unchanged();
+    bool append();
+    bool rewrite(int uid, int gid);
+
+public:
+    // opens and locks the DB directory and checks if the index is up to date, without reading it,
+    // has to be created before the directory is changed
+    WsIndex(const string dbdir);
+    ~WsIndex();
+
+    // the locked DB directory, -1 if it could not be opened, for the *at calls of the caller
+    int getdirfd() const {
+        return dirfd;
+    }
+
+    // index was up to date when opened
+    bool isfresh() {
+        return fresh;
+    }
+
+    void put(const WsIndexEntry &entry);
+    void remove(const string id);
+
+    // forget current content and state, used to rebuild from the YAML files read after this
+    void clear();
+
+    // append the changes if the index was up to date, or write it anew if cleared or if the log
+    // got too large, file gets owner uid:gid then. A directory changed by others since clear()
+    // removes the index instead.
+    bool commit(int uid, int gid);
+
+    // remove the index file, for changes that can not be committed, until rebuilt
+    void invalidate();
+
+    // all entries, reads the whole index unless cleared, it is not fresh if that fails
+    const map<string, WsIndexEntry> &getentries();
+
+    // DB entry ids (directory entries looking like user-name) of a DB directory
+    static vector<string> list_dbdir(const string dbdir);
+};
+
+#endif
@@ -0,0 +1,44 @@
+# checks for
+#  index is reported missing before ws_dbindex was run
+#  rebuild of the index from the DB entries
+#  index is kept up to date by ws_allocate
+#  index lists the new workspace
+#  allocate, extend and release are appended to the index and keep it up to date
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+../bin/ws_dbindex -F ws1 --check 2> $testname/err1.res > $testname/out1.res
+ret1=$?
+../bin/ws_dbindex -F ws1 --rebuild 2> $testname/err2.res > $testname/out2.res
+ret2=$?
+sudo -u usera ../bin/ws_allocate -F ws1 indexed 10 > /dev/null 2> /dev/null
+../bin/ws_dbindex -F ws1 --check 2> $testname/err3.res > $testname/out3.res
+ret3=$?
+../bin/ws_dbindex -F ws1 --dump 2> $testname/err4.res | grep -v '^index of' | cut -d' ' -f 2 > $testname/out4.res
+sudo -u usera ../bin/ws_allocate -F ws1 appended 10 > /dev/null 2> /dev/null
+sudo -u usera ../bin/ws_allocate -F ws1 -x appended 20 > /dev/null 2> /dev/null
+sudo -u usera ../bin/ws_release -F ws1 appended > /dev/null 2> /dev/null
+../bin/ws_dbindex -F ws1 --check 2> $testname/err5.res > $testname/out5.res
+ret5=$?
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/out2.res $testname/out2.ref
+cmp2=$?
+cmp --quiet $testname/out3.res $testname/out3.ref
+cmp3=$?
+cmp --quiet $testname/out4.res $testname/out4.ref
+cmp4=$?
+cmp --quiet $testname/out5.res $testname/out3.ref
+cmp6=$?
+cat $testname/err1.res $testname/err2.res $testname/err3.res $testname/err4.res $testname/err5.res > $testname/err.res
+cmp --quiet $testname/err.res $testname/err.ref
+cmp5=$?
+
+if [ $ret1 != 1 -o $ret2 != 0 -o $ret3 != 0 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 -o $cmp4 != 0 -o $cmp5 != 0 -o $ret5 != 0 -o $cmp6 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $ret3 $cmp1 $cmp2 $cmp3 $cmp4 $cmp5 $ret5 $cmp6"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi
@@ -0,0 +1,36 @@
+# checks for
+#  snapshot of ws.conf is written and up to date
+#  ws_allocate works with the snapshot
+#  snapshot is outdated after ws.conf changed
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+../bin/ws_compile_config 2> $testname/err1.res > $testname/out1.res
+ret1=$?
+../bin/ws_compile_config -c 2> $testname/err2.res > $testname/out2.res
+ret2=$?
+sudo -u usera ../bin/ws_allocate -F ws3 compiled 10 2> $testname/err3.res > $testname/out3.res
+ret3=$?
+cp input/ws.conf.1 /etc/ws.conf
+../bin/ws_compile_config -c 2> $testname/err4.res > $testname/out4.res
+ret4=$?
+rm -f /etc/ws.conf.bin
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/out2.res $testname/out2.ref
+cmp2=$?
+cmp --quiet $testname/out3.res $testname/out3.ref
+cmp3=$?
+cmp --quiet $testname/err3.res $testname/err3.ref
+cmp4=$?
+cmp --quiet $testname/out4.res $testname/out4.ref
+cmp5=$?
+
+if [ $ret1 != 0 -o $ret2 != 0 -o $ret3 != 0 -o $ret4 != 1 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 -o $cmp4 != 0 -o $cmp5 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $ret3 $ret4 $cmp1 $cmp2 $cmp3 $cmp4 $cmp5"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi
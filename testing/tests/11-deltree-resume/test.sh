@@ -0,0 +1,44 @@
+# checks for
+#  ws_deltree stops at the time limit and writes a journal
+#  next ws_deltree continues from the journal
+#  all files are counted once and tree and journal are gone
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+tree=/tmp/ws/ws3/.removed/usera-deltree-1
+mkdir -p $tree
+for d in $(seq 1 50)
+do
+	mkdir $tree/d$d
+	for f in $(seq 1 20)
+	do
+		echo x > $tree/d$d/f$f
+	done
+done
+
+../bin/ws_deltree -t 1 -r 100 -l 1 $tree 2> $testname/err1.res > $testname/run1.res
+ret1=$?
+tail -1 $testname/run1.res > $testname/out1.res
+../bin/ws_deltree $tree 2> $testname/err2.res > $testname/run2.res
+ret2=$?
+sed -n 's/ with .*//p' $testname/run2.res > $testname/out2.res
+cat $testname/run1.res $testname/run2.res | awk '/^removed/ {n+=$2} END {print n}' >> $testname/out2.res
+ls -A /tmp/ws/ws3/.removed > $testname/ls.res
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/out2.res $testname/out2.ref
+cmp2=$?
+cmp --quiet $testname/ls.res $testname/ls.ref
+cmp3=$?
+cat $testname/err1.res $testname/err2.res > $testname/err.res
+cmp --quiet $testname/err.res $testname/err.ref
+cmp4=$?
+
+if [ $ret1 != 2 -o $ret2 != 0 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 -o $cmp4 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $cmp1 $cmp2 $cmp3 $cmp4"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi
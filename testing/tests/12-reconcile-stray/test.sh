@@ -0,0 +1,55 @@
+# checks for
+#  stray workspace is found while the DB index is up to date
+#  DB entry written without updating the index is not taken for a stray
+#  plan of a dry run of ws_expirer lists the stray workspace
+#  stray workspace is moved to .removed when the plan is applied
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+cp input/ws.conf.3 /etc/ws.conf
+
+mkdir /tmp/ws/ws1/usera-stray
+../bin/ws_reconcile -F ws1 2> $testname/err1.res > $testname/rec1.res
+ret1=$?
+sed 's/-[0-9]*$/-TIME/' $testname/rec1.res > $testname/out1.res
+
+# like a ws_allocate without index, the index is outdated then
+sed 's#usera-indexed#usera-legacy#' /tmp/ws/ws1-db/usera-indexed > /tmp/ws/ws1-db/usera-legacy
+chown --reference=/tmp/ws/ws1-db/usera-indexed /tmp/ws/ws1-db/usera-legacy
+mkdir /tmp/ws/ws1/usera-legacy
+../bin/ws_reconcile -F ws1 2> $testname/err2.res > $testname/rec2.res
+ret2=$?
+sed 's/-[0-9]*$/-TIME/' $testname/rec2.res > $testname/out2.res
+
+PATH=$PWD/../bin:$PATH ../sbin/ws_expirer -w ws1 --plan $testname/plan.res > /dev/null 2> $testname/err3.res
+ret3=$?
+grep -v '^#' $testname/plan.res | grep -v '^plan' > $testname/out3.res
+PATH=$PWD/../bin:$PATH ../sbin/ws_expirer -c --apply $testname/plan.res > /dev/null 2> $testname/err4.res
+ret4=$?
+ls -A /tmp/ws/ws1 /tmp/ws/ws1/.removed | sed 's/-[0-9]*$/-TIME/' > $testname/ls.res
+../bin/ws_dbindex -F ws1 --check > $testname/out5.res 2>&1
+ret5=$?
+
+cp input/ws.conf.1 /etc/ws.conf
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/out2.res $testname/out2.ref
+cmp2=$?
+cmp --quiet $testname/out3.res $testname/out3.ref
+cmp3=$?
+cmp --quiet $testname/ls.res $testname/ls.ref
+cmp4=$?
+cmp --quiet $testname/out5.res $testname/out5.ref
+cmp5=$?
+cat $testname/err1.res $testname/err2.res $testname/err3.res $testname/err4.res | grep -v '^Warning: no deldir_timeout' > $testname/err.res
+cmp --quiet $testname/err.res $testname/err.ref
+cmp6=$?
+
+if [ $ret1 != 0 -o $ret2 != 0 -o $ret3 != 0 -o $ret4 != 0 -o $ret5 != 0 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 -o $cmp4 != 0 -o $cmp5 != 0 -o $cmp6 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $ret3 $ret4 $ret5 $cmp1 $cmp2 $cmp3 $cmp4 $cmp5 $cmp6"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi
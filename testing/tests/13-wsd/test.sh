@@ -0,0 +1,51 @@
+# checks for
+#  allocate and release through wsd, with binaries without setuid bit
+#  wsd removes its socket when stopped
+#  binaries without setuid bit fail without wsd
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+nosuid=/tmp/ws-nosuid
+mkdir -p $nosuid
+cp ../bin/ws_allocate ../bin/ws_release $nosuid
+chmod 755 $nosuid $nosuid/ws_allocate $nosuid/ws_release
+
+../bin/wsd > /dev/null 2> $testname/wsd.res &
+wsdpid=$!
+for i in $(seq 1 50)
+do
+	[ -S /run/wsd.sock ] && break
+	sleep 0.1
+done
+
+sudo -u usera $nosuid/ws_allocate -F ws3 viawsd 10 2> $testname/err1.res > $testname/out1.res
+ret1=$?
+sudo -u usera $nosuid/ws_release -F ws3 viawsd 2> $testname/err2.res > $testname/out2.res
+ret2=$?
+ls /tmp/ws/ws3/.removed | sed 's/-[0-9]*$/-TIME/' > $testname/ls.res
+
+kill $wsdpid
+wait $wsdpid
+ls /run/wsd.sock > /dev/null 2>&1
+ret3=$?
+sudo -u usera $nosuid/ws_allocate -F ws3 withoutwsd 10 > /dev/null 2>&1
+ret4=$?
+rm -rf $nosuid
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/err1.res $testname/err1.ref
+cmp2=$?
+cmp --quiet $testname/ls.res $testname/ls.ref
+cmp3=$?
+cat $testname/out2.res $testname/err2.res $testname/wsd.res > $testname/err.res
+cmp --quiet $testname/err.res $testname/err.ref
+cmp4=$?
+
+if [ $ret1 != 0 -o $ret2 != 0 -o $ret3 = 0 -o $ret4 = 0 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 -o $cmp4 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $ret3 $ret4 $cmp1 $cmp2 $cmp3 $cmp4"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi
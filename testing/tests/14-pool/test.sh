@@ -0,0 +1,42 @@
+# checks for
+#  ws_expirer --refill fills the pool with directories of dbuid and mode 000
+#  ws_allocate takes a directory from the pool, owner and permissions correct
+#  one directory is left in the pool
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+cp input/ws.conf.4 /etc/ws.conf
+
+PATH=$PWD/../bin:$PATH ../sbin/ws_expirer -c --refill 2> $testname/err1.res > $testname/run1.res
+ret1=$?
+grep refilling $testname/run1.res > $testname/out1.res
+stat -c '%A %u %g %n' /tmp/ws/ws3/.pool/* > $testname/ls1.res
+
+sudo -u usera ../bin/ws_allocate -F ws3 pooled 10 2> $testname/err2.res > $testname/out2.res
+ret2=$?
+ls -dl /tmp/ws/ws3/usera-pooled | cut -d' ' -f 1,3,4 > $testname/ls2.res
+ls -A /tmp/ws/ws3/.pool | wc -l > $testname/ls3.res
+
+cp input/ws.conf.1 /etc/ws.conf
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/ls1.res $testname/ls1.ref
+cmp2=$?
+cmp --quiet $testname/out2.res $testname/out2.ref
+cmp3=$?
+cmp --quiet $testname/ls2.res $testname/ls2.ref
+cmp4=$?
+cmp --quiet $testname/ls3.res $testname/ls3.ref
+cmp5=$?
+grep -v '^Warning: no deldir_timeout' $testname/err1.res > $testname/err.res
+cmp --quiet $testname/err.res $testname/err.ref
+cmp6=$?
+
+if [ $ret1 != 0 -o $ret2 != 0 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 -o $cmp4 != 0 -o $cmp5 != 0 -o $cmp6 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $cmp1 $cmp2 $cmp3 $cmp4 $cmp5 $cmp6"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi
@@ -0,0 +1,52 @@
+# checks for
+#  ws_expirer -d moves a stray workspace in its first pass
+#  ws_expirer -d notices a release in the DB within expirer_poll seconds
+#  ws_expirer -d keeps running until stopped
+
+testname=${0%%test.sh}
+printf "%-60s " ${testname%%/}
+
+cp input/ws.conf.4 /etc/ws.conf
+
+mkdir /tmp/ws/ws3/usera-stray
+PATH=$PWD/../bin:$PATH ../sbin/ws_expirer -c -d -w ws3 > $testname/run.res 2> $testname/err1.res &
+expirerpid=$!
+for i in $(seq 1 100)
+do
+	[ -d /tmp/ws/ws3/usera-stray ] || break
+	sleep 0.1
+done
+
+sudo -u usera ../bin/ws_release -F ws3 pooled 2> $testname/err2.res > $testname/out2.res
+ret2=$?
+for i in $(seq 1 100)
+do
+	grep -q "^DB of ws3 changed" $testname/run.res && break
+	sleep 0.1
+done
+
+kill -0 $expirerpid
+ret1=$?
+kill $expirerpid
+wait $expirerpid 2> /dev/null
+
+cp input/ws.conf.1 /etc/ws.conf
+
+grep -o "^start of pass for ws3\|^DB of ws3 changed" $testname/run.res | uniq > $testname/out1.res
+ls /tmp/ws/ws3 /tmp/ws/ws3/.removed | sed 's/-[0-9]*$/-TIME/' > $testname/ls.res
+
+cmp --quiet $testname/out1.res $testname/out1.ref
+cmp1=$?
+cmp --quiet $testname/ls.res $testname/ls.ref
+cmp2=$?
+cat $testname/out2.res $testname/err2.res > $testname/err.res
+grep -v '^Warning: no deldir_timeout' $testname/err1.res >> $testname/err.res
+cmp --quiet $testname/err.res $testname/err.ref
+cmp3=$?
+
+if [ $ret1 != 0 -o $ret2 != 0 -o $cmp1 != 0 -o $cmp2 != 0 -o $cmp3 != 0 ]
+then
+	echo -e "\e[1;31mfailed\e[0m $ret1 $ret2 $cmp1 $cmp2 $cmp3"
+else	
+	echo -e "\e[1;32msuccess\e[0m"
+fi